@@ -0,0 +1,71 @@
+#include "plumed/lepton/Lepton.h"
+#include <cmath>
+#include <fstream>
+#include <string>
+#include <vector>
+
+using namespace PLMD;
+
+// compare the values computed for many sets of variables at once with the ones
+// computed by the scalar evaluate(), including stride 0 (broadcast variables)
+// and numbers of sets that are not multiple of the vector width or of the block size
+
+bool differ(double a,double b){
+  if(a==b) return false;
+  return !(std::fabs(a-b)<=1e-12*std::fmax(1.0,std::fabs(a)));
+}
+
+int run(const std::string & expression,int n,int xstride,int ystride){
+  lepton::CompiledExpression scalar=lepton::Parser::parse(expression).optimize().createCompiledExpression();
+  lepton::CompiledExpression batch=lepton::Parser::parse(expression).optimize().createCompiledExpression();
+// values are chosen so that step and delta are also computed at zero
+  std::vector<double> x(n*xstride+1),y(n*ystride+1);
+  for(unsigned i=0;i<x.size();i++) x[i]=0.25*(int(i%9)-4);
+  for(unsigned i=0;i<y.size();i++) y[i]=1.0+0.5*(i%5);
+// the last element should not be written
+  std::vector<double> result(n+1,-999.0);
+  std::vector<const double*> variables;
+  std::vector<int> strides;
+  for(const auto & name : batch.getVariables()){
+    if(name=="x"){variables.push_back(&x[0]); strides.push_back(xstride);}
+    if(name=="y"){variables.push_back(&y[0]); strides.push_back(ystride);}
+  }
+  batch.evaluate(n,variables,strides,&result[0]);
+  int failures=0;
+  for(int i=0;i<n;i++){
+    if(scalar.getVariables().count("x")) scalar.getVariableReference("x")=x[i*xstride];
+    if(scalar.getVariables().count("y")) scalar.getVariableReference("y")=y[i*ystride];
+    if(differ(scalar.evaluate(),result[i])) failures++;
+  }
+  if(result[n]!=-999.0) failures++;
+  return failures;
+}
+
+int main(int argc,char*argv[]){
+  std::string name="logfile";
+  if(argc>1) name+="-"+std::string(argv[1]);
+  std::ofstream ofs(name);
+  std::vector<std::string> expressions={
+    "x*y+x/y-3*x+2",
+    "-x+sqrt(y)",
+    "step(x)*y+step(x-y)",
+    "delta(x)+2*delta(y-1)",
+    "x^2+x^3-y^-2+x^5",
+    "y^0.5+y^-1.5",
+    "exp(-x*x)*sin(y)+x*x",
+    "atan2(x,y)*x",
+    "2"
+  };
+  std::vector<int> sizes={1,3,4,5,63,64,65,130};
+  for(const auto & e : expressions){
+    int failures=0;
+    for(auto n : sizes) {
+      failures+=run(e,n,1,1);
+      failures+=run(e,n,2,1);
+      failures+=run(e,n,1,0);
+      failures+=run(e,n,0,3);
+    }
+    ofs<<e<<" failures "<<failures<<"\n";
+  }
+  return 0;
+}
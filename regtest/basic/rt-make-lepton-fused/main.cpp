@@ -0,0 +1,106 @@
+#include "plumed/lepton/Lepton.h"
+#include <cmath>
+#include <fstream>
+#include <string>
+#include <vector>
+
+using namespace PLMD;
+
+// compare several expressions compiled together, with getResult() and with the
+// batched evaluate() returning all the results, to the same expressions compiled separately
+
+bool differ(double a,double b){
+  if(a==b) return false;
+  return !(std::fabs(a-b)<=1e-12*std::fmax(1.0,std::fabs(a)));
+}
+
+void setVariables(lepton::CompiledExpression & e,double x,double y){
+  if(e.getVariables().count("x")) e.getVariableReference("x")=x;
+  if(e.getVariables().count("y")) e.getVariableReference("y")=y;
+}
+
+int run(const std::vector<std::string> & expressions){
+  std::vector<lepton::ParsedExpression> parsed;
+  std::vector<lepton::CompiledExpression> separate;
+  for(const auto & e : expressions){
+// d/dx stands for the derivative of the first expression
+    if(e=="d/dx") parsed.push_back(parsed[0].differentiate("x").optimize());
+    else parsed.push_back(lepton::Parser::parse(e).optimize());
+    separate.push_back(parsed.back().createCompiledExpression());
+  }
+  lepton::CompiledExpression fused(parsed);
+// also test a copy, which should generate its own code
+  lepton::CompiledExpression copy(fused);
+  int failures=0;
+
+  const int n=70;
+  std::vector<double> x(n),y(n);
+  for(int i=0;i<n;i++){
+    x[i]=0.25*(i%9-4);
+    y[i]=1.0+0.5*(i%5);
+  }
+
+  for(int i=0;i<n;i++){
+    setVariables(fused,x[i],y[i]);
+    setVariables(copy,x[i],y[i]);
+    double value=fused.evaluate();
+    if(differ(copy.evaluate(),value)) failures++;
+    if(differ(fused.getResult(0),value)) failures++;
+    for(unsigned j=0;j<separate.size();j++){
+      setVariables(separate[j],x[i],y[i]);
+      const double ref=separate[j].evaluate();
+      if(differ(fused.getResult(j),ref)) failures++;
+      if(differ(copy.getResult(j),ref)) failures++;
+    }
+  }
+
+  std::vector<const double*> variables;
+  std::vector<int> strides;
+  for(const auto & name : fused.getVariables()){
+    if(name=="x") variables.push_back(&x[0]);
+    if(name=="y") variables.push_back(&y[0]);
+    strides.push_back(1);
+  }
+  std::vector<std::vector<double> > results(separate.size(),std::vector<double>(n,-999.0));
+  std::vector<double*> pointers;
+// all the results
+  for(auto & r : results) pointers.push_back(&r[0]);
+  fused.evaluate(n,variables,strides,pointers);
+  for(int i=0;i<n;i++) for(unsigned j=0;j<separate.size();j++){
+      setVariables(separate[j],x[i],y[i]);
+      if(differ(results[j][i],separate[j].evaluate())) failures++;
+    }
+// only some of the results, skipping the first one
+  for(auto & r : results) for(auto & v : r) v=-999.0;
+  pointers.resize(separate.size()-1);
+  pointers[0]=NULL;
+  copy.evaluate(n,variables,strides,pointers);
+  for(int i=0;i<n;i++) for(unsigned j=0;j<separate.size();j++){
+      setVariables(separate[j],x[i],y[i]);
+      if(j==0 || j==separate.size()-1) {
+        if(results[j][i]!=-999.0) failures++;
+      } else if(differ(results[j][i],separate[j].evaluate())) failures++;
+    }
+  return failures;
+}
+
+int main(int argc,char*argv[]){
+  std::string name="logfile";
+  if(argc>1) name+="-"+std::string(argv[1]);
+  std::ofstream ofs(name);
+  std::vector<std::vector<std::string> > sets={
+// the roots of the later expressions are subexpressions of the first one, or variables
+    {"exp(-(x-y)^2/2)*sqrt(x*x+y*y)","d/dx","exp(-(x-y)^2/2)","sqrt(x*x+y*y)","x","y"},
+// an expression repeated, and a constant
+    {"x*y+sin(x)","x*y+sin(x)","d/dx","3"},
+// the first root is a variable
+    {"x","x*x+y","y"},
+// a switching function and its derivative
+    {"step(2-x)*(1-(x/2)^6)/(1-(x/2)^12)","d/dx"}
+  };
+  for(const auto & s : sets){
+    for(unsigned i=0;i<s.size();i++) ofs<<(i>0?" ; ":"")<<s[i];
+    ofs<<"\nfailures "<<run(s)<<"\n";
+  }
+  return 0;
+}
@@ -29,6 +29,7 @@
 #include "core/FlexibleBin.h"
 #include "tools/Matrix.h"
 #include "tools/Random.h"
+#include "tools/OpenMP.h"
 #include <string>
 #include <cstring>
 #include "tools/File.h"
@@ -36,6 +37,7 @@
 #include <limits>
 #include <ctime>
 #include <memory>
+#include <unordered_map>
 
 #define DP2CUTOFF 6.25
 
@@ -401,6 +403,21 @@ private:
   vector<double> sigma0min_;
   vector<double> sigma0max_;
   vector<Gaussian> hills_;
+// when GRID is not used, hills with a diagonal covariance are stored as a structure of arrays,
+// with one contiguous array per CV, so that their evaluation can be vectorized.
+// Only multivariate hills are stored in hills_
+  vector<vector<double> > hills_center_;
+  vector<vector<double> > hills_invsigma_;
+  vector<double> hills_height_;
+  vector<double> hills_period_;
+  vector<double> hills_min_;
+// spatial index of the diagonal hills. Hills are put in the buckets of a uniform grid whose
+// spacing along each CV is not smaller than the largest cutoff, so that only the hills in
+// the buckets neighboring a point have to be evaluated
+  vector<double> hills_bucket_width_;
+  vector<long> hills_bucket_nper_;
+  std::unordered_map<unsigned long long,vector<unsigned> > hills_buckets_;
+  vector<unsigned> hills_neighbors_;
   OFile hillsOfile_;
   OFile gridfile_;
   std::unique_ptr<GridBase> BiasGrid_;
@@ -459,13 +476,20 @@ private:
   static void   registerTemperingKeywords(const std::string &name_stem, const std::string &name, Keywords &keys);
   void   readTemperingSpecs(TemperingSpecs &t_specs);
   void   logTemperingSpecs(const TemperingSpecs &t_specs);
-  void   readGaussians(IFile*);
+  unsigned readGaussians(IFile*);
   void   writeGaussian(const Gaussian&,OFile&);
   void   addGaussian(const Gaussian&);
   double getHeight(const vector<double>&);
   void   temperHeight(double &height, const TemperingSpecs &t_specs, const double tempering_bias);
   double getBiasAndDerivatives(const vector<double>&,double* der=NULL);
-  double evaluateGaussian(const vector<double>&, const Gaussian&,double* der=NULL);
+/// Evaluate a single hill. The optional buffer dp_tmp (with one element per argument)
+/// is used as workspace, so that the function can be called from multiple threads
+  double evaluateGaussian(const vector<double>&, const Gaussian&,double* der=NULL,double* dp_tmp=NULL);
+  double evaluateDiagonalHills(const double* cv, double* der, const unsigned* index, unsigned begin, unsigned end);
+  void   clearHills();
+  void   indexHill(unsigned);
+  long   getHillsBucketCoordinate(unsigned i, double x) const;
+  void   getNeighborHills(const double* cv, vector<unsigned>& neighbors) const;
   double getGaussianNormalization( const Gaussian& );
   vector<unsigned> getGaussianSupport(const Gaussian&);
   bool   scanOneHill(IFile *ifile,  vector<Value> &v, vector<double> &center, vector<double>  &sigma, double &height, bool &multivariate);
@@ -500,6 +524,8 @@ void MetaD::registerKeywords(Keywords& keys) {
   keys.add("compulsory","FILE","HILLS","a file in which the list of added hills is stored");
   keys.add("optional","HEIGHT","the heights of the Gaussian hills. Compulsory unless TAU and either BIASFACTOR or DAMPFACTOR are given");
   keys.add("optional","FMT","specify format for HILLS files (useful for decrease the number of digits in regtests)");
+  keys.add("compulsory","FILE_FORMAT","text","the format of the HILLS file: text or binary. Binary files keep full precision and are much faster to read, and can be converted to text with \\ref convert_hills");
+  keys.addFlag("ASYNC_HILLS",false,"write the HILLS file from a background thread, so that the simulation is not blocked by disk access");
   keys.add("optional","BIASFACTOR","use well tempered metadynamics and use this bias factor.  Please note you must also specify temp");
   keys.add("optional","RECT","list of bias factors for all the replicas");
   keys.add("optional","DAMPFACTOR","damp hills with exp(-max(V)/(\\f$k_B\\f$T*DAMPFACTOR)");
@@ -606,6 +632,12 @@ MetaD::MetaD(const ActionOptions& ao):
   }
 
   parse("FMT",fmt);
+  bool async_hills=false;
+  parseFlag("ASYNC_HILLS",async_hills);
+  string file_format;
+  parse("FILE_FORMAT",file_format);
+  if(file_format!="text" && file_format!="binary") error("FILE_FORMAT should be either text or binary");
+  const bool binary_hills=(file_format=="binary");
 
   // parse the sigma
   parseVector("SIGMA",sigma0_);
@@ -1181,7 +1213,9 @@ MetaD::MetaD(const ActionOptions& ao):
       ifile->open(fname);
       if(getRestart()&&!restartedFromGrid) {
         log.printf("  Restarting from %s:",ifilesnames[i].c_str());
-        readGaussians(ifiles[i].get());
+        unsigned nhills=readGaussians(ifiles[i].get());
+        // new hills will be appended to this file
+        if(i==mw_id_ && nhills>0 && ifile->isBinary()!=binary_hills) error("FILE_FORMAT does not match the format of file "+fname);
       }
       ifiles[i]->reset(false);
       // close only the walker own hills file for later writing
@@ -1247,6 +1281,10 @@ MetaD::MetaD(const ActionOptions& ao):
     hillsOfile_.enforceSuffix("");
   }
   if(mw_n_>1) hillsOfile_.enforceSuffix("");
+  if(binary_hills) {
+    hillsOfile_.setBinary();
+    log.printf("  Hills file is written in binary format\n");
+  }
   hillsOfile_.open(ifilesnames[mw_id_]);
   if(fmt.length()>0) hillsOfile_.fmtField(fmt);
   hillsOfile_.addConstantField("multivariate");
@@ -1256,6 +1294,11 @@ MetaD::MetaD(const ActionOptions& ao):
     hillsOfile_.addConstantField("upper_int").printField("upper_int",uppI_);
   }
   hillsOfile_.setHeavyFlush();
+  if(async_hills) {
+    hillsOfile_.setAsync();
+    if(hillsOfile_.isAsync()) log.printf("  Hills file is written asynchronously\n");
+    else log.printf("  WARNING: could not start a thread for writing hills, the file will be written synchronously\n");
+  }
   // output periodicities of variables
   for(unsigned i=0; i<getNumberOfArguments(); ++i) hillsOfile_.setupPrintValue( getPntrToArgument(i) );
 
@@ -1332,7 +1375,7 @@ void MetaD::logTemperingSpecs(const TemperingSpecs &t_specs) {
   if (t_specs.alpha != 1.0) log.printf("  %s decay shape parameter alpha %f\n", t_specs.name.c_str(), t_specs.alpha);
 }
 
-void MetaD::readGaussians(IFile *ifile)
+unsigned MetaD::readGaussians(IFile *ifile)
 {
   unsigned ncv=getNumberOfArguments();
   vector<double> center(ncv);
@@ -1352,6 +1395,7 @@ void MetaD::readGaussians(IFile *ifile)
     addGaussian(Gaussian(center,sigma,height,multivariate));
   }
   log.printf("      %d Gaussians read\n",nhills);
+  return nhills;
 }
 
 void MetaD::writeGaussian(const Gaussian& hill, OFile&file)
@@ -1407,38 +1451,67 @@ void MetaD::writeGaussian(const Gaussian& hill, OFile&file)
 
 void MetaD::addGaussian(const Gaussian& hill)
 {
-  if(!grid_) hills_.push_back(hill);
-  else {
+  if(!grid_) {
+    if(hill.multivariate) {
+      hills_.push_back(hill);
+    } else {
+      unsigned ncv=getNumberOfArguments();
+      if(hills_center_.size()!=ncv) {
+        hills_center_.resize(ncv);
+        hills_invsigma_.resize(ncv);
+        hills_period_.assign(ncv,0.0);
+        hills_min_.assign(ncv,0.0);
+        hills_bucket_width_.assign(ncv,0.0);
+        hills_bucket_nper_.assign(ncv,0);
+        for(unsigned i=0; i<ncv; ++i) if(getPntrToArgument(i)->isPeriodic()) {
+            double max;
+            getPntrToArgument(i)->getDomain(hills_min_[i],max);
+            hills_period_[i]=max-hills_min_[i];
+          }
+      }
+      for(unsigned i=0; i<ncv; ++i) {
+        hills_center_[i].push_back(hill.center[i]);
+        hills_invsigma_[i].push_back(hill.invsigma[i]);
+      }
+      hills_height_.push_back(hill.height);
+      indexHill(hills_height_.size()-1);
+    }
+  } else if(!hill.multivariate && !doInt_) {
+    // a diagonal Gaussian is the product of one-dimensional Gaussians and can be
+    // deposited with an outer product of one-dimensional tables.
+    // this is cheap enough to be done redundantly on all the processes
+    BiasGrid_->addSeparableGaussian(hill.center,hill.invsigma,hill.height,getGaussianSupport(hill),DP2CUTOFF);
+  } else {
     unsigned ncv=getNumberOfArguments();
     vector<unsigned> nneighb=getGaussianSupport(hill);
     vector<Grid::index_t> neighbors=BiasGrid_->getNeighbors(hill.center,nneighb);
     vector<double> der(ncv);
-    vector<double> xx(ncv);
-    if(comm.Get_size()==1) {
-      for(unsigned i=0; i<neighbors.size(); ++i) {
-        Grid::index_t ineigh=neighbors[i];
-        for(unsigned j=0; j<ncv; ++j) der[j]=0.0;
-        BiasGrid_->getPoint(ineigh,xx);
-        double bias=evaluateGaussian(xx,hill,&der[0]);
-        BiasGrid_->addValueAndDerivatives(ineigh,bias,der);
-      }
-    } else {
-      unsigned stride=comm.Get_size();
-      unsigned rank=comm.Get_rank();
-      vector<double> allder(ncv*neighbors.size(),0.0);
-      vector<double> allbias(neighbors.size(),0.0);
-      for(unsigned i=rank; i<neighbors.size(); i+=stride) {
-        Grid::index_t ineigh=neighbors[i];
-        BiasGrid_->getPoint(ineigh,xx);
-        allbias[i]=evaluateGaussian(xx,hill,&allder[ncv*i]);
+    // the Gaussian is evaluated on the grid points in parallel (over both MPI processes and threads)
+    // and then added serially, so that the result does not depend on the number of threads
+    unsigned stride=comm.Get_size();
+    unsigned rank=comm.Get_rank();
+    const unsigned nneigh=neighbors.size();
+    vector<double> allder(ncv*nneigh,0.0);
+    vector<double> allbias(nneigh,0.0);
+    unsigned nt=OpenMP::getNumThreads();
+    if(nt*stride*64>nneigh) nt=1;
+    #pragma omp parallel num_threads(nt)
+    {
+      vector<double> xx(ncv);
+      vector<double> dp(ncv);
+      #pragma omp for
+      for(unsigned i=rank; i<nneigh; i+=stride) {
+        BiasGrid_->getPoint(neighbors[i],xx);
+        allbias[i]=evaluateGaussian(xx,hill,&allder[ncv*i],&dp[0]);
       }
+    }
+    if(stride>1) {
       comm.Sum(allbias);
       comm.Sum(allder);
-      for(unsigned i=0; i<neighbors.size(); ++i) {
-        Grid::index_t ineigh=neighbors[i];
-        for(unsigned j=0; j<ncv; ++j) {der[j]=allder[ncv*i+j];}
-        BiasGrid_->addValueAndDerivatives(ineigh,allbias[i],der);
-      }
+    }
+    for(unsigned i=0; i<nneigh; ++i) {
+      for(unsigned j=0; j<ncv; ++j) der[j]=allder[ncv*i+j];
+      BiasGrid_->addValueAndDerivatives(neighbors[i],allbias[i],der);
     }
   }
 }
@@ -1497,19 +1570,128 @@ vector<unsigned> MetaD::getGaussianSupport(const Gaussian& hill)
   return nneigh;
 }
 
+void MetaD::clearHills()
+{
+  hills_.clear();
+  for(unsigned i=0; i<hills_center_.size(); ++i) {
+    hills_center_[i].clear();
+    hills_invsigma_[i].clear();
+  }
+  hills_height_.clear();
+  hills_buckets_.clear();
+}
+
+void MetaD::indexHill(unsigned ihill)
+{
+  unsigned ncv=getNumberOfArguments();
+// the buckets must be at least as large as the cutoff of this hill.
+// A zero sigma means that the hill is not truncated along that CV
+  bool rebuild=false;
+  for(unsigned i=0; i<ncv; ++i) {
+    double invsigma=std::abs(hills_invsigma_[i][ihill]);
+    double cutoff=(invsigma>0.0 ? sqrt(2.0*DP2CUTOFF)/invsigma : std::numeric_limits<double>::infinity());
+    if(cutoff>hills_bucket_width_[i]) {
+      hills_bucket_width_[i]=cutoff;
+      if(hills_period_[i]>0.0) hills_bucket_nper_[i]=std::max(1L,static_cast<long>(std::floor(hills_period_[i]/cutoff)));
+      rebuild=true;
+    }
+  }
+  unsigned first=ihill;
+  if(rebuild) {
+    hills_buckets_.clear();
+    first=0;
+  }
+  vector<long> coord(ncv);
+  for(unsigned ih=first; ih<=ihill; ++ih) {
+    unsigned long long key=0;
+    for(unsigned i=0; i<ncv; ++i) key=key*1000003ULL+static_cast<unsigned long long>(getHillsBucketCoordinate(i,hills_center_[i][ih]));
+    hills_buckets_[key].push_back(ih);
+  }
+}
+
+long MetaD::getHillsBucketCoordinate(unsigned i, double x) const
+{
+  if(hills_period_[i]>0.0) {
+    double s=(x-hills_min_[i])/hills_period_[i];
+    s-=std::floor(s);
+    return std::min(static_cast<long>(s*hills_bucket_nper_[i]),hills_bucket_nper_[i]-1);
+  }
+  return static_cast<long>(std::floor(x/hills_bucket_width_[i]));
+}
+
+void MetaD::getNeighborHills(const double* cv, vector<unsigned>& neighbors) const
+{
+  unsigned ncv=getNumberOfArguments();
+// coordinates of the buckets to be visited along each CV
+  vector<vector<long> > coords(ncv);
+  for(unsigned i=0; i<ncv; ++i) {
+    long c=getHillsBucketCoordinate(i,cv[i]);
+    if(hills_bucket_width_[i]==std::numeric_limits<double>::infinity()) {
+      coords[i].push_back(c);
+    } else if(hills_period_[i]>0.0) {
+      long n=hills_bucket_nper_[i];
+      for(long k=-1; k<=1; k++) coords[i].push_back((c+k+n)%n);
+    } else {
+      for(long k=-1; k<=1; k++) coords[i].push_back(c+k);
+    }
+  }
+// loop over all the combinations. Keys are made unique so that each bucket is only visited once,
+// even when there are less than three buckets along a periodic CV
+  vector<unsigned long long> keys;
+  vector<unsigned> counter(ncv,0);
+  while(true) {
+    unsigned long long key=0;
+    for(unsigned i=0; i<ncv; ++i) key=key*1000003ULL+static_cast<unsigned long long>(coords[i][counter[i]]);
+    keys.push_back(key);
+    unsigned i=0;
+    for(; i<ncv; ++i) {
+      counter[i]++;
+      if(counter[i]<coords[i].size()) break;
+      counter[i]=0;
+    }
+    if(i==ncv) break;
+  }
+  std::sort(keys.begin(),keys.end());
+  keys.erase(std::unique(keys.begin(),keys.end()),keys.end());
+  neighbors.clear();
+  for(const auto & key : keys) {
+    auto bucket=hills_buckets_.find(key);
+    if(bucket!=hills_buckets_.end()) neighbors.insert(neighbors.end(),bucket->second.begin(),bucket->second.end());
+  }
+// hills are evaluated in the same order in which they were added
+  std::sort(neighbors.begin(),neighbors.end());
+}
+
 double MetaD::getBiasAndDerivatives(const vector<double>& cv, double* der)
 {
   double bias=0.0;
   if(!grid_) {
-    if(hills_.size()>10000 && (getStep()-last_step_warn_grid)>10000) {
+    unsigned nhills=hills_.size()+hills_height_.size();
+    if(nhills>10000 && (getStep()-last_step_warn_grid)>10000) {
       std::string msg;
-      Tools::convert(hills_.size(),msg);
+      Tools::convert(nhills,msg);
       msg="You have accumulated "+msg+" hills, you should enable GRIDs to avoid serious performance hits";
       warning(msg);
       last_step_warn_grid=getStep();
     }
     unsigned stride=comm.Get_size();
     unsigned rank=comm.Get_rank();
+// diagonal hills are split in contiguous blocks among processes.
+// When there are many of them, only those in the neighboring buckets are considered
+    unsigned ndiag=hills_height_.size();
+    const unsigned* index=NULL;
+    if(ndiag>0 && ndiag>std::pow(3.0,static_cast<double>(cv.size()))) {
+      double x=cv[0];
+      if(doInt_) x=std::min(std::max(x,lowI_),uppI_);
+      getNeighborHills(doInt_ ? &x : cv.data(),hills_neighbors_);
+      ndiag=hills_neighbors_.size();
+      index=hills_neighbors_.data();
+    }
+    if(ndiag>0) {
+      unsigned begin=(static_cast<unsigned long>(ndiag)*rank)/stride;
+      unsigned end=(static_cast<unsigned long>(ndiag)*(rank+1))/stride;
+      bias+=evaluateDiagonalHills(cv.data(),der,index,begin,end);
+    }
     for(unsigned i=rank; i<hills_.size(); i+=stride) {
       bias+=evaluateGaussian(cv,hills_[i],der);
     }
@@ -1552,8 +1734,9 @@ double MetaD::getGaussianNormalization( const Gaussian& hill )
   return norm*pow(2*pi,static_cast<double>(ncv)/2.0);
 }
 
-double MetaD::evaluateGaussian(const vector<double>& cv, const Gaussian& hill, double* der)
+double MetaD::evaluateGaussian(const vector<double>& cv, const Gaussian& hill, double* der, double* dp_tmp)
 {
+  double* dpbuf=(dp_tmp ? dp_tmp : dp_.get());
   double dp2=0.0;
   double bias=0.0;
   // I use a pointer here because cv is const (and should be const)
@@ -1582,7 +1765,7 @@ double MetaD::evaluateGaussian(const vector<double>& cv, const Gaussian& hill, d
     }
     for(unsigned i=0; i<cv.size(); ++i) {
       double dp_i=difference(i,hill.center[i],pcv[i]);
-      dp_[i]=dp_i;
+      dpbuf[i]=dp_i;
       for(unsigned j=i; j<cv.size(); ++j) {
         if(i==j) {
           dp2+=dp_i*dp_i*mymatrix(i,j)*0.5;
@@ -1598,7 +1781,7 @@ double MetaD::evaluateGaussian(const vector<double>& cv, const Gaussian& hill, d
         for(unsigned i=0; i<cv.size(); ++i) {
           double tmp=0.0;
           for(unsigned j=0; j<cv.size(); ++j) {
-            tmp += dp_[j]*mymatrix(i,j)*bias;
+            tmp += dpbuf[j]*mymatrix(i,j)*bias;
           }
           der[i]-=tmp;
         }
@@ -1608,13 +1791,13 @@ double MetaD::evaluateGaussian(const vector<double>& cv, const Gaussian& hill, d
     for(unsigned i=0; i<cv.size(); ++i) {
       double dp=difference(i,hill.center[i],pcv[i])*hill.invsigma[i];
       dp2+=dp*dp;
-      dp_[i]=dp;
+      dpbuf[i]=dp;
     }
     dp2*=0.5;
     if(dp2<DP2CUTOFF) {
       bias=hill.height*exp(-dp2);
       if(der) {
-        for(unsigned i=0; i<cv.size(); ++i) {der[i]+=-bias*dp_[i]*hill.invsigma[i];}
+        for(unsigned i=0; i<cv.size(); ++i) {der[i]+=-bias*dpbuf[i]*hill.invsigma[i];}
       }
     }
   }
@@ -1626,6 +1809,95 @@ double MetaD::evaluateGaussian(const vector<double>& cv, const Gaussian& hill, d
   return bias;
 }
 
+double MetaD::evaluateDiagonalHills(const double* cv, double* der, const unsigned* index, unsigned begin, unsigned end)
+{
+  const unsigned ncv=getNumberOfArguments();
+// hills are processed in blocks, and the loops on the hills of a block are vectorized
+  const unsigned blocksize=256;
+  const unsigned nblocks=(end-begin+blocksize-1)/blocksize;
+
+// with INTERVAL the cv is replaced with the closest boundary
+  const double *pcv=cv;
+  double tmpcv[1];
+  if(doInt_) {
+    plumed_assert(ncv==1);
+    tmpcv[0]=cv[0];
+    if(cv[0]<lowI_) tmpcv[0]=lowI_;
+    if(cv[0]>uppI_) tmpcv[0]=uppI_;
+    pcv=tmpcv;
+  }
+
+  unsigned nt=OpenMP::getNumThreads();
+  if(nt>nblocks) nt=1;
+
+  double bias=0.0;
+  #pragma omp parallel num_threads(nt)
+  {
+    std::vector<double> dp(ncv*blocksize);
+    std::vector<double> dp2(blocksize);
+    std::vector<double> omp_der(der && nt>1 ? ncv : 0,0.0);
+    double* myder=(nt>1 ? omp_der.data() : der);
+// buffers where hills are gathered when a list of indexes is provided
+    std::vector<double> gcenter(index ? ncv*blocksize : 0);
+    std::vector<double> ginvsigma(index ? ncv*blocksize : 0);
+    std::vector<double> gheight(index ? blocksize : 0);
+
+    #pragma omp for reduction(+:bias) nowait
+    for(unsigned iblock=0; iblock<nblocks; ++iblock) {
+      const unsigned start=begin+iblock*blocksize;
+      const unsigned n=std::min(blocksize,end-start);
+      if(index) {
+        for(unsigned i=0; i<ncv; ++i) for(unsigned j=0; j<n; ++j) {
+            gcenter[i*blocksize+j]=hills_center_[i][index[start+j]];
+            ginvsigma[i*blocksize+j]=hills_invsigma_[i][index[start+j]];
+          }
+        for(unsigned j=0; j<n; ++j) gheight[j]=hills_height_[index[start+j]];
+      }
+      for(unsigned j=0; j<n; ++j) dp2[j]=0.0;
+      for(unsigned i=0; i<ncv; ++i) {
+        const double* center=(index ? &gcenter[i*blocksize] : &hills_center_[i][start]);
+        const double* invsigma=(index ? &ginvsigma[i*blocksize] : &hills_invsigma_[i][start]);
+        double* dpi=&dp[i*blocksize];
+        const double x=pcv[i];
+        if(hills_period_[i]>0.0) {
+          const double period=hills_period_[i];
+          const double invperiod=1.0/period;
+          #pragma omp simd
+          for(unsigned j=0; j<n; ++j) dpi[j]=Tools::pbc((x-center[j])*invperiod)*period*invsigma[j];
+        } else {
+          #pragma omp simd
+          for(unsigned j=0; j<n; ++j) dpi[j]=(x-center[j])*invsigma[j];
+        }
+        #pragma omp simd
+        for(unsigned j=0; j<n; ++j) dp2[j]+=dpi[j]*dpi[j];
+      }
+// from now on dp2 contains the bias of each hill
+      const double* height=(index ? &gheight[0] : &hills_height_[start]);
+      for(unsigned j=0; j<n; ++j) {
+        const double arg=0.5*dp2[j];
+        dp2[j]=(arg<DP2CUTOFF ? height[j]*exp(-arg) : 0.0);
+        bias+=dp2[j];
+      }
+      if(myder) for(unsigned i=0; i<ncv; ++i) {
+          const double* invsigma=(index ? &ginvsigma[i*blocksize] : &hills_invsigma_[i][start]);
+          const double* dpi=&dp[i*blocksize];
+          double d=myder[i];
+          for(unsigned j=0; j<n; ++j) d+=-dp2[j]*dpi[j]*invsigma[j];
+          myder[i]=d;
+        }
+    }
+    if(der && nt>1) {
+      #pragma omp critical
+      for(unsigned i=0; i<ncv; ++i) der[i]+=omp_der[i];
+    }
+  }
+
+  if(doInt_ && der) {
+    if(cv[0]<lowI_ || cv[0]>uppI_) der[0]=0.0;
+  }
+  return bias;
+}
+
 double MetaD::getHeight(const vector<double>& cv)
 {
   double height=height0_;
@@ -1760,7 +2032,7 @@ void MetaD::update() {
 
       // Flying Gaussian
       if (flying) {
-        hills_.clear();
+        clearHills();
         comm.Barrier();
       }
 
@@ -1834,8 +2106,8 @@ void MetaD::update() {
           ifiles[i]->open(ifilesnames[i]);
           ifiles[i]->reset(false);
         }
-        // otherwise read the new Gaussians
-      } else {
+        // otherwise read the new Gaussians, if any
+      } else if(ifiles[i]->hasNewData()) {
         log.printf("  Reading hills from %s:",ifilesnames[i].c_str());
         readGaussians(ifiles[i].get());
         ifiles[i]->reset(false);
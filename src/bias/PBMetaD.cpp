@@ -267,7 +267,7 @@ private:
   unsigned select_value_;
   unsigned current_value_;
 
-  void   readGaussians(unsigned iarg, IFile*);
+  unsigned readGaussians(unsigned iarg, IFile*);
   void   writeGaussian(unsigned iarg, const Gaussian&, OFile*);
   void   addGaussian(unsigned iarg, const Gaussian&);
   double getBiasAndDerivatives(unsigned iarg, const vector<double>&, double* der=NULL);
@@ -294,6 +294,7 @@ void PBMetaD::registerKeywords(Keywords& keys) {
   keys.add("optional","FILE","files in which the lists of added hills are stored, default names are assigned using arguments if FILE is not found");
   keys.add("optional","HEIGHT","the height of the Gaussian hills, one for all biases. Compulsory unless TAU, TEMP and BIASFACTOR are given");
   keys.add("optional","FMT","specify format for HILLS files (useful for decrease the number of digits in regtests)");
+  keys.add("compulsory","FILE_FORMAT","text","the format of the HILLS files: text or binary. Binary files keep full precision and are much faster to read, and can be converted to text with \\ref convert_hills");
   keys.add("optional","BIASFACTOR","use well tempered metadynamics with this bias factor, one for all biases.  Please note you must also specify temp");
   keys.add("optional","TEMP","the system temperature - this is only needed if you are doing well-tempered metadynamics");
   keys.add("optional","TAU","in well tempered metadynamics, sets height to (\\f$k_B \\Delta T\\f$*pace*timestep)/tau");
@@ -350,6 +351,10 @@ PBMetaD::PBMetaD(const ActionOptions& ao):
   }
 
   parse("FMT",fmt);
+  string file_format;
+  parse("FILE_FORMAT",file_format);
+  if(file_format!="text" && file_format!="binary") error("FILE_FORMAT should be either text or binary");
+  const bool binary_hills=(file_format=="binary");
 
   // parse the sigma
   parseVector("SIGMA",sigma0_);
@@ -540,6 +545,7 @@ PBMetaD::PBMetaD(const ActionOptions& ao):
   log.printf("  Gaussian files ");
   for(unsigned i=0; i<hillsfname.size(); ++i) log.printf("%s ",hillsfname[i].c_str());
   log.printf("\n");
+  if(binary_hills) log.printf("  Gaussian files are written in binary format\n");
   if(welltemp_) {
     log.printf("  Well-Tempered Bias Factor %f\n",biasf_);
     log.printf("  Hills relaxation time (tau) %f\n",tau);
@@ -697,7 +703,9 @@ PBMetaD::PBMetaD(const ActionOptions& ao):
         ifile->open(fname);
         if(getRestart()&&!restartedFromGrid) {
           log.printf("  Restarting from %s:",ifilesnames[k].c_str());
-          readGaussians(i,ifiles[k].get());
+          unsigned nhills=readGaussians(i,ifiles[k].get());
+          // new hills will be appended to this file
+          if(j==mw_id_ && nhills>0 && ifile->isBinary()!=binary_hills) error("FILE_FORMAT does not match the format of file "+fname);
         }
         ifiles[k]->reset(false);
         // close only the walker own hills file for later writing
@@ -725,6 +733,7 @@ PBMetaD::PBMetaD(const ActionOptions& ao):
       ofile->enforceSuffix("");
     }
     if(mw_n_>1) ofile->enforceSuffix("");
+    if(binary_hills) ofile->setBinary();
     ofile->open(ifilesnames[mw_id_*hillsfname.size()+i]);
     if(fmt.length()>0) ofile->fmtField(fmt);
     ofile->addConstantField("multivariate");
@@ -774,7 +783,7 @@ PBMetaD::PBMetaD(const ActionOptions& ao):
   log<<"\n";
 }
 
-void PBMetaD::readGaussians(unsigned iarg, IFile *ifile)
+unsigned PBMetaD::readGaussians(unsigned iarg, IFile *ifile)
 {
   vector<double> center(1);
   vector<double> sigma(1);
@@ -792,6 +801,7 @@ void PBMetaD::readGaussians(unsigned iarg, IFile *ifile)
     addGaussian(iarg, Gaussian(center,sigma,height,multivariate));
   }
   log.printf("      %d Gaussians read\n",nhills);
+  return nhills;
 }
 
 void PBMetaD::writeGaussian(unsigned iarg, const Gaussian& hill, OFile *ofile)
@@ -820,7 +830,10 @@ void PBMetaD::writeGaussian(unsigned iarg, const Gaussian& hill, OFile *ofile)
 void PBMetaD::addGaussian(unsigned iarg, const Gaussian& hill)
 {
   if(!grid_) {hills_[iarg].push_back(hill);}
-  else {
+  else if(!hill.multivariate && !doInt_[iarg]) {
+    // one-dimensional tables are cheap enough to be computed redundantly on all the processes
+    BiasGrids_[iarg]->addSeparableGaussian(hill.center,hill.invsigma,hill.height,getGaussianSupport(iarg,hill),DP2CUTOFF);
+  } else {
     vector<unsigned> nneighb=getGaussianSupport(iarg, hill);
     vector<Grid::index_t> neighbors=BiasGrids_[iarg]->getNeighbors(hill.center,nneighb);
     vector<double> der(1);
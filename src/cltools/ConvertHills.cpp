@@ -0,0 +1,140 @@
+/* +++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++
+   Copyright (c) 2020 The plumed team
+   (see the PEOPLE file at the root of the distribution for a list of names)
+
+   See http://www.plumed.org for more information.
+
+   This file is part of plumed, version 2.
+
+   plumed is free software: you can redistribute it and/or modify
+   it under the terms of the GNU Lesser General Public License as published by
+   the Free Software Foundation, either version 3 of the License, or
+   (at your option) any later version.
+
+   plumed is distributed in the hope that it will be useful,
+   but WITHOUT ANY WARRANTY; without even the implied warranty of
+   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+   GNU Lesser General Public License for more details.
+
+   You should have received a copy of the GNU Lesser General Public License
+   along with plumed.  If not, see <http://www.gnu.org/licenses/>.
++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++ */
+#include "CLTool.h"
+#include "CLToolRegister.h"
+#include "tools/Tools.h"
+#include "tools/Communicator.h"
+#include "tools/IFile.h"
+#include "tools/OFile.h"
+#include <cstdio>
+#include <string>
+#include <vector>
+#include <algorithm>
+
+using namespace std;
+
+namespace PLMD {
+namespace cltools {
+
+//+PLUMEDOC TOOLS convert_hills
+/*
+convert_hills converts a HILLS file between the text and the binary format
+
+Binary HILLS files are written by \ref METAD and \ref PBMETAD when using FILE_FORMAT=binary.
+They store numbers with full precision and can be read much faster than text files.
+Binary files are recognized automatically when they are read, so they can be
+used directly to restart a simulation or with \ref sum_hills.
+This tool can be used to inspect them or to convert text files to the binary format.
+It can be used on any file written in the fielded format (e.g. a COLVAR file),
+provided all its non-constant fields are numbers.
+
+\par Examples
+
+The following command converts a binary HILLS file to text
+
+\verbatim
+plumed convert_hills --ifile HILLS.bin --ofile HILLS
+\endverbatim
+
+The following command converts a text HILLS file to the binary format
+
+\verbatim
+plumed convert_hills --ifile HILLS --ofile HILLS.bin --binary
+\endverbatim
+
+*/
+//+ENDPLUMEDOC
+
+class ConvertHills:
+  public CLTool
+{
+public:
+  static void registerKeywords( Keywords& keys );
+  explicit ConvertHills(const CLToolOptions& co );
+  int main(FILE* in, FILE*out,Communicator& pc) override;
+  string description()const override {
+    return "convert HILLS files between text and binary format";
+  }
+};
+
+PLUMED_REGISTER_CLTOOL(ConvertHills,"convert_hills")
+
+void ConvertHills::registerKeywords( Keywords& keys ) {
+  CLTool::registerKeywords( keys );
+  keys.add("compulsory","--ifile","the name of the input file, either text or binary");
+  keys.add("compulsory","--ofile","the name of the output file");
+  keys.addFlag("--binary",false,"write the output file in binary format. Otherwise, it is written as text");
+  keys.add("optional","--fmt","the format used to write numbers in text files");
+}
+
+ConvertHills::ConvertHills(const CLToolOptions& co ):
+  CLTool(co)
+{
+  inputdata=commandline;
+}
+
+int ConvertHills::main(FILE* in, FILE*out,Communicator& pc) {
+  string ifilename; parse("--ifile",ifilename);
+  string ofilename; parse("--ofile",ofilename);
+  bool binary; parseFlag("--binary",binary);
+  string fmt; parse("--fmt",fmt);
+
+  IFile ifile;
+  ifile.link(pc);
+  ifile.open(ifilename);
+
+  OFile ofile;
+  ofile.link(pc);
+  if(binary) ofile.setBinary();
+  ofile.open(ofilename);
+  if(fmt.length()>0) ofile.fmtField(fmt);
+
+  vector<string> fields;
+  vector<string> constants;
+  unsigned nlines=0;
+  while(true) {
+    ifile.scanFieldList(fields);
+    if(!ifile) break;
+    for(const auto & f : fields) {
+      if(ifile.FieldIsConstant(f)) {
+        if(std::find(constants.begin(),constants.end(),f)==constants.end()) {
+          ofile.addConstantField(f);
+          constants.push_back(f);
+        }
+        string v; ifile.scanField(f,v);
+        ofile.printField(f,v);
+      } else {
+        double v; ifile.scanField(f,v);
+        ofile.printField(f,v);
+      }
+    }
+    ifile.scanField();
+    ofile.printField();
+    nlines++;
+  }
+  ofile.close();
+  std::fprintf(out,"%u lines written to %s\n",nlines,ofilename.c_str());
+  return 0;
+}
+
+} // End of namespace
+}
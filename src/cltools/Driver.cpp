@@ -246,6 +246,7 @@ void Driver<real>::registerKeywords( Keywords& keys ) {
   keys.add("hidden","--debug-float","[yes/no] turns on the single precision version (to check float interface)");
   keys.add("hidden","--debug-dd","[yes/no] use a fake domain decomposition");
   keys.add("hidden","--debug-pd","[yes/no] use a fake particle decomposition");
+  keys.add("hidden","--debug-async-calc","[yes/no] use startCalc/waitCalc and overwrite the positions while plumed is calculating");
   keys.add("hidden","--debug-grex","use a fake gromacs-like replica exchange, specify exchange stride");
   keys.add("hidden","--debug-grex-log","log file for debug=grex");
 #ifdef __PLUMED_HAS_MOLFILE_PLUGINS
@@ -281,6 +282,7 @@ int Driver<real>::main(FILE* in,FILE*out,Communicator& pc) {
             "  [--debug-float yes]     : turns on the single precision version (to check float interface)\n"
             "  [--debug-dd yes]        : use a fake domain decomposition\n"
             "  [--debug-pd yes]        : use a fake particle decomposition\n"
+            "  [--debug-async-calc yes]: use startCalc/waitCalc and overwrite the positions while plumed is calculating\n"
            );
     return 0;
   }
@@ -322,6 +324,15 @@ int Driver<real>::main(FILE* in,FILE*out,Communicator& pc) {
   }
   if(debug_dd) fprintf(out,"DEBUGGING DOMAIN DECOMPOSITION\n");
 
+  bool debug_async_calc=false;
+  fakein="";
+  if(parse("--debug-async-calc",fakein)) {
+    if(fakein=="yes") debug_async_calc=true;
+    else if(fakein=="no") debug_async_calc=false;
+    else error("--debug-async-calc should have argument yes or no");
+  }
+  if(debug_async_calc) fprintf(out,"DEBUGGING ASYNCHRONOUS CALCULATION\n");
+
   if( debug_pd || debug_dd ) {
     if(noatoms) error("cannot debug without atoms");
   }
@@ -949,7 +960,19 @@ int Driver<real>::main(FILE* in,FILE*out,Communicator& pc) {
       p.cmd("setStepLong",&step);
       p.cmd("setStopFlag",&plumedStopCondition);
     }
-    p.cmd("calc");
+    if(debug_async_calc) {
+      p.cmd("startCalc");
+// this mimics an MD code that moves atoms while plumed is calculating.
+// plumed should have already stored the positions, so that this should not affect its results
+      std::vector<real> saved_coordinates(coordinates), saved_dd_coordinates(dd_coordinates);
+      coordinates.assign(coordinates.size(),std::numeric_limits<real>::quiet_NaN());
+      dd_coordinates.assign(dd_coordinates.size(),std::numeric_limits<real>::quiet_NaN());
+      p.cmd("waitCalc");
+      coordinates=saved_coordinates;
+      dd_coordinates=saved_dd_coordinates;
+    } else {
+      p.cmd("calc");
+    }
     if(debugforces.length()>0) {
       virial.assign(9,real(0.0));
       forces.assign(3*natoms,real(0.0));
@@ -90,6 +90,7 @@ public:
   explicit Angle(const ActionOptions&);
 // active methods:
   void calculate() override;
+  bool canBeCalculatedConcurrently()const override {return true;}
   static void registerKeywords( Keywords& keys );
 };
 
@@ -50,6 +50,9 @@ but it can be changed using the optional SWITCH option.
 
 To make your calculation faster you can use a neighbor list, which makes it that only a
 relevant subset of the pairwise distance are calculated at every step.
+The neighbor list can either be updated with a fixed stride (NL_STRIDE) or
+automatically, using a skin (NL_SKIN). In the latter case all the pairs closer than NL_CUTOFF+NL_SKIN
+are stored, and the list is updated as soon as an atom has moved more than half the skin since the last update.
 
 If GROUPB is empty, it will sum the \f$\frac{N(N-1)}{2}\f$ pairs in GROUPA. This avoids computing
 twice permuted indexes (e.g. pair (i,j) and (j,i)) thus running at twice the speed.
@@ -66,6 +69,21 @@ The following example instructs plumed to calculate the total coordination numbe
 COORDINATION GROUPA=1-10 GROUPB=20-100 R_0=0.3 NLIST NL_CUTOFF=0.5 NL_STRIDE=100
 \endplumedfile
 
+The same calculation can be done with a neighbor list that is only updated when needed. Here
+all the pairs closer than 0.6 nm are stored, and the list is updated when an atom moves more than 0.05 nm.
+The number of updates is written in the log at the end of the simulation.
+\plumedfile
+COORDINATION GROUPA=1-10 GROUPB=20-100 R_0=0.3 NLIST NL_CUTOFF=0.5 NL_SKIN=0.1
+\endplumedfile
+
+For large groups, the switching function can be computed in single precision using PRECISION=mixed.
+Distances and the sums over pairs are still computed in double precision, so that the
+relative error on the coordination number and on its derivatives is of the order of 1e-7.
+This is usually acceptable when PLUMED is coupled with an MD code running in single precision.
+\plumedfile
+COORDINATION GROUPA=1-1000 GROUPB=1001-2000 R_0=0.3 PRECISION=mixed
+\endplumedfile
+
 The following is a dummy example which should compute the value 0 because the self interaction
 of atom 1 is skipped. Notice that in plumed 2.0 "self interactions" were not skipped, and the
 same calculation should return 1.
@@ -104,12 +122,16 @@ public:
 // active methods:
   static void registerKeywords( Keywords& keys );
   double pairing(double distance,double&dfunc,unsigned i,unsigned j)const override;
+  void pairingBatch(unsigned n,const double* distance2,double* result,double* dfunc,const unsigned* i,const unsigned* j)const override;
+  void pairingBatch(unsigned n,const float* distance2,float* result,float* dfunc,const unsigned* i,const unsigned* j)const override;
 };
 
 PLUMED_REGISTER_ACTION(Coordination,"COORDINATION")
 
 void Coordination::registerKeywords( Keywords& keys ) {
   CoordinationBase::registerKeywords(keys);
+  keys.add("compulsory","PRECISION","double","the precision used to compute the switching function on each pair. With mixed, it is computed in single precision "
+           "while distances and the sums over pairs are computed in double precision");
   keys.add("compulsory","NN","6","The n parameter of the switching function ");
   keys.add("compulsory","MM","0","The m parameter of the switching function; 0 implies 2*NN");
   keys.add("compulsory","D_0","0.0","The d_0 parameter of the switching function");
@@ -153,6 +175,18 @@ double Coordination::pairing(double distance,double&dfunc,unsigned i,unsigned j)
   return switchingFunction.calculateSqr(distance,dfunc);
 }
 
+void Coordination::pairingBatch(unsigned n,const double* distance2,double* result,double* dfunc,const unsigned* i,const unsigned* j)const {
+  (void) i; // avoid warnings
+  (void) j; // avoid warnings
+  switchingFunction.calculateSqr(n,distance2,result,dfunc);
+}
+
+void Coordination::pairingBatch(unsigned n,const float* distance2,float* result,float* dfunc,const unsigned* i,const unsigned* j)const {
+  (void) i; // avoid warnings
+  (void) j; // avoid warnings
+  switchingFunction.calculateSqr(n,distance2,result,dfunc);
+}
+
 }
 
 }
@@ -25,6 +25,7 @@
 #include "tools/OpenMP.h"
 
 #include <string>
+#include <algorithm>
 
 using namespace std;
 
@@ -38,6 +39,7 @@ void CoordinationBase::registerKeywords( Keywords& keys ) {
   keys.addFlag("NLIST",false,"Use a neighbor list to speed up the calculation");
   keys.add("optional","NL_CUTOFF","The cutoff for the neighbor list");
   keys.add("optional","NL_STRIDE","The frequency with which we are updating the atoms in the neighbor list");
+  keys.add("optional","NL_SKIN","The skin of the neighbor list. Pairs within NL_CUTOFF+NL_SKIN are stored and the list is updated as soon as an atom moves more than half the skin. Cannot be used together with NL_STRIDE");
   keys.add("atoms","GROUPA","First list of atoms");
   keys.add("atoms","GROUPB","Second list of atoms (if empty, N*(N-1)/2 pairs in GROUPA are counted)");
 }
@@ -47,11 +49,20 @@ CoordinationBase::CoordinationBase(const ActionOptions&ao):
   pbc(true),
   serial(false),
   invalidateList(true),
-  firsttime(true)
+  firsttime(true),
+  mixedPrecision(false)
 {
 
   parseFlag("SERIAL",serial);
 
+// PRECISION is only registered by the actions implementing the single precision pairingBatch()
+  if(keywords.exists("PRECISION")) {
+    std::string precision;
+    parse("PRECISION",precision);
+    if(precision=="mixed") mixedPrecision=true;
+    else if(precision!="double") error("PRECISION should be either double or mixed");
+  }
+
   vector<AtomNumber> ga_lista,gb_lista;
   parseAtomList("GROUPA",ga_lista);
   parseAtomList("GROUPB",gb_lista);
@@ -67,21 +78,28 @@ CoordinationBase::CoordinationBase(const ActionOptions&ao):
 // neighbor list stuff
   bool doneigh=false;
   double nl_cut=0.0;
+  double nl_skin=0.0;
   int nl_st=0;
   parseFlag("NLIST",doneigh);
   if(doneigh) {
     parse("NL_CUTOFF",nl_cut);
     if(nl_cut<=0.0) error("NL_CUTOFF should be explicitly specified and positive");
+    parse("NL_SKIN",nl_skin);
     parse("NL_STRIDE",nl_st);
-    if(nl_st<=0) error("NL_STRIDE should be explicitly specified and positive");
+    if(nl_skin>0.0) {
+      if(nl_st!=0) error("NL_STRIDE cannot be used together with NL_SKIN");
+    } else {
+      if(nl_skin<0.0) error("NL_SKIN should be positive");
+      if(nl_st<=0) error("NL_STRIDE should be explicitly specified and positive");
+    }
   }
 
   addValueWithDerivatives(); setNotPeriodic();
   if(gb_lista.size()>0) {
-    if(doneigh)  nl.reset( new NeighborList(ga_lista,gb_lista,dopair,pbc,getPbc(),nl_cut,nl_st) );
+    if(doneigh)  nl.reset( new NeighborList(ga_lista,gb_lista,dopair,pbc,getPbc(),nl_cut,nl_st,nl_skin) );
     else         nl.reset( new NeighborList(ga_lista,gb_lista,dopair,pbc,getPbc()) );
   } else {
-    if(doneigh)  nl.reset( new NeighborList(ga_lista,pbc,getPbc(),nl_cut,nl_st) );
+    if(doneigh)  nl.reset( new NeighborList(ga_lista,pbc,getPbc(),nl_cut,nl_st,nl_skin) );
     else         nl.reset( new NeighborList(ga_lista,pbc,getPbc()) );
   }
 
@@ -104,12 +122,14 @@ CoordinationBase::CoordinationBase(const ActionOptions&ao):
   if(dopair) log.printf("  with PAIR option\n");
   if(doneigh) {
     log.printf("  using neighbor lists with\n");
-    log.printf("  update every %d steps and cutoff %f\n",nl_st,nl_cut);
+    if(nl_skin>0.0) log.printf("  cutoff %f and skin %f, update when an atom moves more than half the skin\n",nl_cut,nl_skin);
+    else log.printf("  update every %d steps and cutoff %f\n",nl_st,nl_cut);
   }
 }
 
 CoordinationBase::~CoordinationBase() {
 // destructor required to delete forward declared class
+  if(nl->getSkin()>0.0) log.printf("  neighbor list of action %s has been updated %u times\n",getLabel().c_str(),nl->getNumberOfUpdates());
 }
 
 void CoordinationBase::prepare() {
@@ -127,6 +147,21 @@ void CoordinationBase::prepare() {
   }
 }
 
+void CoordinationBase::pairingBatch(unsigned n,const double* distance2,double* result,double* dfunc,const unsigned* i,const unsigned* j)const {
+  for(unsigned k=0; k<n; ++k) {
+    dfunc[k]=0.;
+    result[k]=pairing(distance2[k],dfunc[k],i[k],j[k]);
+  }
+}
+
+void CoordinationBase::pairingBatch(unsigned n,const float* distance2,float* result,float* dfunc,const unsigned* i,const unsigned* j)const {
+  for(unsigned k=0; k<n; ++k) {
+    double df=0.;
+    result[k]=pairing(distance2[k],df,i[k],j[k]);
+    dfunc[k]=df;
+  }
+}
+
 // calculator
 void CoordinationBase::calculate()
 {
@@ -138,6 +173,8 @@ void CoordinationBase::calculate()
 
   if(nl->getStride()>0 && invalidateList) {
     nl->update(getPositions());
+  } else if(nl->getSkin()>0.0 && nl->isUpdateNeeded(getPositions())) {
+    nl->update(getPositions());
   }
 
   unsigned stride;
@@ -154,41 +191,76 @@ void CoordinationBase::calculate()
   const unsigned nn=nl->size();
   if(nt*stride*10>nn) nt=1;
 
+// pairs are processed in batches, so that the pairing function can be evaluated
+// on arrays of distances (see pairingBatch())
+  const unsigned batchsize=256;
+  const unsigned nlocal=(nn>rank ? (nn-rank+stride-1)/stride : 0);
+  const unsigned nbatch=(nlocal+batchsize-1)/batchsize;
+
   #pragma omp parallel num_threads(nt)
   {
     std::vector<Vector> omp_deriv(getPositions().size());
     Tensor omp_virial;
+    std::vector<Vector> distances(batchsize);
+    std::vector<double> distances2(batchsize);
+    std::vector<double> values(batchsize);
+    std::vector<double> dfuncs(batchsize);
+    std::vector<unsigned> first(batchsize);
+    std::vector<unsigned> second(batchsize);
+// single precision buffers, only used with PRECISION=mixed
+    std::vector<float> distances2f(mixedPrecision?batchsize:0);
+    std::vector<float> valuesf(mixedPrecision?batchsize:0);
+    std::vector<float> dfuncsf(mixedPrecision?batchsize:0);
 
     #pragma omp for reduction(+:ncoord) nowait
-    for(unsigned int i=rank; i<nn; i+=stride) {
-
-      Vector distance;
-      unsigned i0=nl->getClosePair(i).first;
-      unsigned i1=nl->getClosePair(i).second;
-
-      if(getAbsoluteIndex(i0)==getAbsoluteIndex(i1)) continue;
-
-      if(pbc) {
-        distance=pbcDistance(getPosition(i0),getPosition(i1));
-      } else {
-        distance=delta(getPosition(i0),getPosition(i1));
+    for(unsigned ibatch=0; ibatch<nbatch; ++ibatch) {
+
+      unsigned npairs=0;
+      const unsigned kend=std::min(nlocal,(ibatch+1)*batchsize);
+      for(unsigned k=ibatch*batchsize; k<kend; ++k) {
+        const unsigned i=rank+k*stride;
+        unsigned i0=nl->getClosePair(i).first;
+        unsigned i1=nl->getClosePair(i).second;
+
+        if(getAbsoluteIndex(i0)==getAbsoluteIndex(i1)) continue;
+
+        if(pbc) {
+          distances[npairs]=pbcDistance(getPosition(i0),getPosition(i1));
+        } else {
+          distances[npairs]=delta(getPosition(i0),getPosition(i1));
+        }
+        distances2[npairs]=distances[npairs].modulo2();
+        first[npairs]=i0;
+        second[npairs]=i1;
+        npairs++;
       }
 
-      double dfunc=0.;
-      ncoord += pairing(distance.modulo2(), dfunc,i0,i1);
-
-      Vector dd(dfunc*distance);
-      Tensor vv(dd,distance);
-      if(nt>1) {
-        omp_deriv[i0]-=dd;
-        omp_deriv[i1]+=dd;
-        omp_virial-=vv;
+      if(mixedPrecision) {
+        for(unsigned j=0; j<npairs; ++j) distances2f[j]=distances2[j];
+        pairingBatch(npairs,distances2f.data(),valuesf.data(),dfuncsf.data(),first.data(),second.data());
+        for(unsigned j=0; j<npairs; ++j) {
+          values[j]=valuesf[j];
+          dfuncs[j]=dfuncsf[j];
+        }
       } else {
-        deriv[i0]-=dd;
-        deriv[i1]+=dd;
-        virial-=vv;
+        pairingBatch(npairs,distances2.data(),values.data(),dfuncs.data(),first.data(),second.data());
       }
 
+      for(unsigned j=0; j<npairs; ++j) {
+        ncoord += values[j];
+
+        Vector dd(dfuncs[j]*distances[j]);
+        Tensor vv(dd,distances[j]);
+        if(nt>1) {
+          omp_deriv[first[j]]-=dd;
+          omp_deriv[second[j]]+=dd;
+          omp_virial-=vv;
+        } else {
+          deriv[first[j]]-=dd;
+          deriv[second[j]]+=dd;
+          virial-=vv;
+        }
+      }
     }
     #pragma omp critical
     if(nt>1) {
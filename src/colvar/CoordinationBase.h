@@ -36,6 +36,8 @@ class CoordinationBase : public Colvar {
   std::unique_ptr<NeighborList> nl;
   bool invalidateList;
   bool firsttime;
+/// Compute the pairing function in single precision
+  bool mixedPrecision;
 
 public:
   explicit CoordinationBase(const ActionOptions&);
@@ -44,6 +46,14 @@ public:
   void calculate() override;
   void prepare() override;
   virtual double pairing(double distance,double&dfunc,unsigned i,unsigned j)const=0;
+/// Compute pairing() on n pairs, given the squared distances and the indexes of the atoms.
+/// The default implementation calls pairing() on each pair, but it can be overridden
+/// to evaluate the whole batch at once.
+  virtual void pairingBatch(unsigned n,const double* distance2,double* result,double* dfunc,const unsigned* i,const unsigned* j)const;
+/// Same as pairingBatch(), in single precision. This is used with PRECISION=mixed,
+/// which is only available in the actions registering the PRECISION keyword.
+/// The default implementation calls pairing() on each pair and converts the results.
+  virtual void pairingBatch(unsigned n,const float* distance2,float* result,float* dfunc,const unsigned* i,const unsigned* j)const;
   static void registerKeywords( Keywords& keys );
 };
 
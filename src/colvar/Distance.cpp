@@ -118,6 +118,7 @@ public:
   explicit Distance(const ActionOptions&);
 // active methods:
   void calculate() override;
+  bool canBeCalculatedConcurrently()const override {return true;}
 };
 
 PLUMED_REGISTER_ACTION(Distance,"DISTANCE")
@@ -162,47 +162,56 @@ Gyration::Gyration(const ActionOptions&ao):
 
   addValueWithDerivatives(); setNotPeriodic();
   requestAtoms(atoms);
+// positions are copied only when needed: RADIUS and TRACE read them in separate
+// coordinate arrays, where molecules are also made whole, and makeWhole() copies them
+  doNotCopyPositions();
 }
 
 void Gyration::calculate() {
 
-  if(!nopbc) makeWhole();
-
+  const unsigned natoms=getNumberOfAtoms();
   Vector com;
   double totmass = 0.;
-  if( use_masses ) {
-    for(unsigned i=0; i<getNumberOfAtoms(); i++) {
-      totmass+=getMass(i);
-      com+=getMass(i)*getPosition(i);
-    }
-  } else {
-    totmass = static_cast<double>(getNumberOfAtoms());
-    for(unsigned i=0; i<getNumberOfAtoms(); i++) {
-      com+=getPosition(i);
-    }
-  }
-  com /= totmass;
-
   double rgyr=0.;
-  vector<Vector> derivatives( getNumberOfAtoms() );
+  vector<Vector> derivatives( natoms );
   Tensor virial;
 
   if(rg_type==RADIUS||rg_type==TRACE) {
+    const double *x,*y,*z;
+    getPositionsSoA(x,y,z,!nopbc);
     if( use_masses ) {
-      for(unsigned i=0; i<getNumberOfAtoms(); i++) {
-        const Vector diff = delta( com, getPosition(i) );
-        rgyr          += getMass(i)*diff.modulo2();
-        derivatives[i] = diff*getMass(i);
-        virial        -= Tensor(getPosition(i),derivatives[i]);
+      for(unsigned i=0; i<natoms; i++) {
+        const double m=getMass(i);
+        totmass+=m;
+        com[0]+=m*x[i];
+        com[1]+=m*y[i];
+        com[2]+=m*z[i];
       }
     } else {
-      for(unsigned i=0; i<getNumberOfAtoms(); i++) {
-        const Vector diff = delta( com, getPosition(i) );
-        rgyr          += diff.modulo2();
-        derivatives[i] = diff;
-        virial        -= Tensor(getPosition(i),derivatives[i]);
+      totmass = static_cast<double>(natoms);
+      for(unsigned i=0; i<natoms; i++) {
+        com[0]+=x[i];
+        com[1]+=y[i];
+        com[2]+=z[i];
       }
     }
+    com /= totmass;
+
+// loops on separate coordinates, so that they can be vectorized
+    double v00=0.0,v01=0.0,v02=0.0,v10=0.0,v11=0.0,v12=0.0,v20=0.0,v21=0.0,v22=0.0;
+    for(unsigned i=0; i<natoms; i++) {
+      const double m=use_masses?getMass(i):1.0;
+      const double dx=x[i]-com[0];
+      const double dy=y[i]-com[1];
+      const double dz=z[i]-com[2];
+      rgyr += m*(dx*dx+dy*dy+dz*dz);
+      const double gx=m*dx,gy=m*dy,gz=m*dz;
+      derivatives[i]=Vector(gx,gy,gz);
+      v00-=x[i]*gx; v01-=x[i]*gy; v02-=x[i]*gz;
+      v10-=y[i]*gx; v11-=y[i]*gy; v12-=y[i]*gz;
+      v20-=z[i]*gx; v21-=z[i]*gy; v22-=z[i]*gz;
+    }
+    virial=Tensor(v00,v01,v02,v10,v11,v12,v20,v21,v22);
     double fact;
     if(rg_type==RADIUS) {
       rgyr = sqrt(rgyr/totmass);
@@ -212,11 +221,25 @@ void Gyration::calculate() {
       fact = 4;
     }
     setValue(rgyr);
-    for(unsigned i=0; i<getNumberOfAtoms(); i++) setAtomsDerivatives(i,fact*derivatives[i]);
+    for(unsigned i=0; i<natoms; i++) setAtomsDerivatives(i,fact*derivatives[i]);
     setBoxDerivatives(fact*virial);
     return;
   }
 
+  if(!nopbc) makeWhole();
+
+  if( use_masses ) {
+    for(unsigned i=0; i<natoms; i++) {
+      totmass+=getMass(i);
+      com+=getMass(i)*getPosition(i);
+    }
+  } else {
+    totmass = static_cast<double>(natoms);
+    for(unsigned i=0; i<natoms; i++) {
+      com+=getPosition(i);
+    }
+  }
+  com /= totmass;
 
   Tensor3d gyr_tens;
   //calculate gyration tensor
@@ -50,6 +50,7 @@ PathMSDBase::PathMSDBase(const ActionOptions&ao):
   nopbc(false),
   neigh_size(-1),
   neigh_stride(-1),
+  batched(false),
   epsilonClose(-1),
   debugClose(0),
   logClose(0),
@@ -103,6 +104,14 @@ PathMSDBase::PathMSDBase(const ActionOptions&ao):
     fclose (fp);
     log<<"Found TOTAL "<<nframes<< " PDB in the file "<<reference.c_str()<<" \n";
     if(nframes==0) error("at least one frame expected");
+    // if all the frames have the same weights, distances are computed together
+    batched=true;
+    for(auto & m : msdv) if(!msdBatch.add(m)) {
+        batched=false;
+        msdBatch.clear();
+        break;
+      }
+    if(batched) log<<"  distances from all the frames are computed together\n";
     //set up rmsdRefClose, initialize it to the first structure loaded from reference file
     rmsdPosClose.set(pdbv[0], "OPTIMAL");
     firstPosClose = true;
@@ -234,6 +243,11 @@ void PathMSDBase::calculate() {
       }
     }
   }
+  else if(batched) {
+    std::vector<unsigned> frames(imgVec.size());
+    for(unsigned i=0; i<imgVec.size(); i++) frames[i]=imgVec[i].index;
+    msdBatch.calculate(getPositions(),frames,rank,stride,tmp_distances,tmp_derivs2);
+  }
   else {
     // store temporary local results
     for(unsigned i=rank; i<imgVec.size(); i+=stride) {
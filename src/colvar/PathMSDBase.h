@@ -64,6 +64,8 @@ class PathMSDBase : public Colvar {
   int neigh_size;
   int neigh_stride;
   std::vector<RMSD> msdv;
+  MultiReferenceRMSD msdBatch; // all the frames, used to compute the distances at once when possible
+  bool batched;
   std::string reference;
   std::vector<Vector> derivs_s;
   std::vector<Vector> derivs_z;
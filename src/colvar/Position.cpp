@@ -84,6 +84,7 @@ public:
   explicit Position(const ActionOptions&);
 // active methods:
   void calculate() override;
+  bool canBeCalculatedConcurrently()const override {return true;}
 };
 
 PLUMED_REGISTER_ACTION(Position,"POSITION")
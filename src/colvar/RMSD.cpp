@@ -44,6 +44,7 @@ class RMSD : public Colvar {
 public:
   explicit RMSD(const ActionOptions&);
   void calculate() override;
+  bool canBeCalculatedConcurrently()const override {return true;}
   static void registerKeywords(Keywords& keys);
 };
 
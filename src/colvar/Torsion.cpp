@@ -99,6 +99,7 @@ public:
   explicit Torsion(const ActionOptions&);
 // active methods:
   void calculate() override;
+  bool canBeCalculatedConcurrently()const override {return true;}
   static void registerKeywords(Keywords& keys);
 };
 
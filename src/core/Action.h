@@ -262,6 +262,11 @@ public:
 /// Check if the action needs gradient
   virtual bool checkNeedsGradients()const {return false;}
 
+/// Check if calculate() and apply() can be run concurrently with other actions.
+/// This should only return true for actions that do not communicate, do not write
+/// to files and only modify their own data in these two methods.
+  virtual bool canBeCalculatedConcurrently()const {return false;}
+
 /// Perform calculation using numerical derivatives
 /// N.B. only pass an ActionWithValue to this routine if you know exactly what you
 /// are doing.
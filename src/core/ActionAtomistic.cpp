@@ -25,6 +25,8 @@
 #include "SetupMolInfo.h"
 #include <vector>
 #include <string>
+#include <algorithm>
+#include <cstdint>
 #include "ActionWithValue.h"
 #include "Colvar.h"
 #include "ActionWithVirtualAtom.h"
@@ -44,9 +46,13 @@ ActionAtomistic::~ActionAtomistic() {
 
 ActionAtomistic::ActionAtomistic(const ActionOptions&ao):
   Action(ao),
+  positionsData(NULL),
   lockRequestAtoms(false),
   donotretrieve(false),
   donotforce(false),
+  donotcopy(false),
+  modifyglobalpositions(false),
+  contiguous(false),
   atoms(plumed.getAtoms())
 {
   atoms.add(this);
@@ -63,20 +69,33 @@ void ActionAtomistic::requestAtoms(const vector<AtomNumber> & a, const bool clea
   int nat=a.size();
   indexes=a;
   positions.resize(nat);
+  positionsData=positions.data();
   forces.resize(nat);
   masses.resize(nat);
   charges.resize(nat);
   int n=atoms.positions.size();
   if(clearDep) clearDependencies();
-  unique.clear();
+  std::vector<AtomNumber> newunique;
+  newunique.reserve(indexes.size());
   for(unsigned i=0; i<indexes.size(); i++) {
     if(indexes[i].index()>=n) { std::string num; Tools::convert( indexes[i].serial(),num ); error("atom " + num + " out of range"); }
     if(atoms.isVirtualAtom(indexes[i])) addDependency(atoms.getVirtualAtomsAction(indexes[i]));
 // only real atoms are requested to lower level Atoms class
-    else unique.insert(indexes[i]);
+    else newunique.push_back(indexes[i]);
+  }
+  contiguous=(nat>0);
+  for(unsigned i=1; i<indexes.size(); i++) if(indexes[i].index()!=indexes[0].index()+i) {
+      contiguous=false;
+      break;
+    }
+  std::sort(newunique.begin(),newunique.end());
+  newunique.erase(std::unique(newunique.begin(),newunique.end()),newunique.end());
+// the lists kept in Atoms are only rebuilt if the request has actually changed
+  if(newunique!=unique) {
+    unique.swap(newunique);
+    updateUniqueLocal();
+    atoms.clearUnique();
   }
-  updateUniqueLocal();
-  atoms.unique.clear();
 }
 
 Vector ActionAtomistic::pbcDistance(const Vector &v1,const Vector &v2)const {
@@ -108,6 +127,7 @@ void ActionAtomistic::calculateAtomicNumericalDerivatives( ActionWithValue* a, c
   std::vector<Vector> savedPositions(natoms);
   const double delta=sqrt(epsilon);
 
+  copyPositions();
   for(int i=0; i<natoms; i++) for(int k=0; k<3; k++) {
       savedPositions[i][k]=positions[i][k];
       positions[i][k]=positions[i][k]+delta;
@@ -230,7 +250,11 @@ void ActionAtomistic::retrieveAtoms() {
   const vector<Vector> & p(atoms.positions);
   const vector<double> & c(atoms.charges);
   const vector<double> & m(atoms.masses);
-  for(unsigned j=0; j<indexes.size(); j++) positions[j]=p[indexes[j].index()];
+  if(donotcopy && contiguous) positionsData=&p[indexes[0].index()];
+  else {
+    for(unsigned j=0; j<indexes.size(); j++) positions[j]=p[indexes[j].index()];
+    positionsData=positions.data();
+  }
   for(unsigned j=0; j<indexes.size(); j++) charges[j]=c[indexes[j].index()];
   for(unsigned j=0; j<indexes.size(); j++) masses[j]=m[indexes[j].index()];
 }
@@ -258,7 +282,17 @@ void ActionAtomistic::applyForces() {
   if(donotforce) return;
   vector<Vector>   & f(atoms.forces);
   Tensor           & v(atoms.virial);
-  for(unsigned j=0; j<indexes.size(); j++) f[indexes[j].index()]+=forces[j];
+// forces are only added if some of them are non-zero, so that atoms
+// of actions that do not apply forces (e.g. printed CVs) are not updated in the MD code
+  bool hasForces=false;
+  for(const auto & ff : forces) if(ff[0]!=0.0 || ff[1]!=0.0 || ff[2]!=0.0) {
+      hasForces=true;
+      break;
+    }
+  if(hasForces) {
+    for(unsigned j=0; j<indexes.size(); j++) f[indexes[j].index()]+=forces[j];
+    atoms.addActionWithForces(this);
+  }
   v+=virial;
   atoms.forceOnEnergy+=forceOnEnergy;
   if(extraCV.length()>0) atoms.updateExtraCVForce(extraCV,forceOnExtraCV);
@@ -277,6 +311,7 @@ void ActionAtomistic::readAtomsFromPDB( const PDB& pdb ) {
   Colvar*cc=dynamic_cast<Colvar*>(this);
   if(cc && cc->checkIsEnergy()) error("can't read energies from pdb files");
 
+  positionsData=positions.data();
   for(unsigned j=0; j<indexes.size(); j++) {
     if( indexes[j].index()>pdb.size() ) error("there are not enough atoms in the input pdb file");
     if( pdb.getAtomNumbers()[j].index()!=indexes[j].index() ) error("there are atoms missing in the pdb file");
@@ -287,6 +322,7 @@ void ActionAtomistic::readAtomsFromPDB( const PDB& pdb ) {
 }
 
 void ActionAtomistic::makeWhole() {
+  copyPositions();
   for(unsigned j=0; j<positions.size()-1; ++j) {
     const Vector & first (positions[j]);
     Vector & second (positions[j+1]);
@@ -294,14 +330,45 @@ void ActionAtomistic::makeWhole() {
   }
 }
 
+void ActionAtomistic::copyPositions() {
+  if(positionsData==positions.data()) return;
+  for(unsigned j=0; j<positions.size(); j++) positions[j]=positionsData[j];
+  positionsData=positions.data();
+}
+
+void ActionAtomistic::getPositionsSoA(const double* & x,const double* & y,const double* & z,bool whole) {
+  const unsigned nat=indexes.size();
+// arrays are padded to a multiple of 8 elements, so that all of them are aligned
+  const unsigned stride=(nat+7)/8*8;
+// 8 additional elements leave room to align the beginning of the buffer
+  positionsSoA.resize(3*stride+8);
+  double* p=positionsSoA.data();
+  p+=(64-reinterpret_cast<std::uintptr_t>(p)%64)%64/sizeof(double);
+  double* px=p;
+  double* py=p+stride;
+  double* pz=p+2*stride;
+  for(unsigned j=0; j<nat; j++) {
+    Vector pos=positionsData[j];
+// same operations as in makeWhole()
+    if(whole && j>0) {
+      const Vector first(px[j-1],py[j-1],pz[j-1]);
+      pos=first+pbcDistance(first,pos);
+    }
+    px[j]=pos[0];
+    py[j]=pos[1];
+    pz[j]=pos[2];
+  }
+  x=px; y=py; z=pz;
+}
+
 void ActionAtomistic::updateUniqueLocal() {
   unique_local.clear();
   if(atoms.dd && atoms.shuffledAtoms>0) {
-    for(auto pp=unique.begin(); pp!=unique.end(); ++pp) {
-      if(atoms.g2l[pp->index()]>=0) unique_local.insert(*pp);
+    for(const auto & p : unique) {
+      if(atoms.g2l[p.index()]>=0) unique_local.push_back(p);
     }
   } else {
-    unique_local.insert(unique.begin(),unique.end());
+    unique_local=unique;
   }
 }
 
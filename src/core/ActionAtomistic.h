@@ -43,11 +43,15 @@ class ActionAtomistic :
 {
 
   std::vector<AtomNumber> indexes;         // the set of needed atoms
-/// unique should be an ordered set since we later create a vector containing the corresponding indexes
-  std::set<AtomNumber>  unique;
-/// unique_local should be an ordered set since we later create a vector containing the corresponding indexes
-  std::set<AtomNumber>  unique_local;
+/// unique is a sorted list of the real atoms that are needed, without duplicates
+  std::vector<AtomNumber>  unique;
+/// unique_local is the sorted list of the atoms in unique that are local to this process
+  std::vector<AtomNumber>  unique_local;
   std::vector<Vector>   positions;       // positions of the needed atoms
+/// pointer to the positions of the needed atoms, either to positions or directly to the global array
+  const Vector*         positionsData;
+/// buffer used to store positions as separate x, y and z arrays
+  std::vector<double>   positionsSoA;
   double                energy;
   ForwardDecl<Pbc>      pbc_fwd;
   Pbc&                  pbc=*pbc_fwd;
@@ -67,6 +71,14 @@ class ActionAtomistic :
 
   bool                  donotretrieve;
   bool                  donotforce;
+  bool                  donotcopy;
+/// true if the action modifies the positions of all the atoms in the global array
+  bool                  modifyglobalpositions;
+/// true if the needed atoms are a contiguous range of the global array
+  bool                  contiguous;
+
+/// make a local copy of the positions if they are accessed from the global array
+  void copyPositions();
 
 protected:
   Atoms&                atoms;
@@ -112,7 +124,14 @@ public:
 /// Get box shape
   const Tensor & getBox()const;
 /// Get the array of all positions
+/// \warning Cannot be used if positions are accessed from the global array (see doNotCopyPositions())
   const std::vector<Vector> & getPositions()const;
+/// Get the positions as separate arrays of x, y and z coordinates.
+/// Arrays are aligned to 64 bytes and remain valid until the next call.
+/// They can be used to write loops on large groups of atoms that the compiler can vectorize.
+/// If whole is true, molecules are made whole in the arrays as done by makeWhole(),
+/// so that actions using doNotCopyPositions() can avoid a separate copy of the positions.
+  void getPositionsSoA(const double* & x,const double* & y,const double* & z,bool whole=false);
 /// Get energy
   const double & getEnergy()const;
 /// Get mass of i-th atom
@@ -159,10 +178,21 @@ public:
 /// If this function is called during initialization, then forces are
 /// not going to be propagated. Can be used for optimization.
   void doNotForce() {donotforce=true;}
+/// Skip copy of positions - use with care.
+/// If this function is called during initialization and the requested atoms
+/// are a contiguous range of the global array, positions are not copied
+/// at every step and getPosition(int) accesses directly the global array.
+/// getPositions() cannot be used in this case. makeWhole() and numerical
+/// derivatives still work, since they first make a local copy.
+  void doNotCopyPositions() {donotcopy=true;}
 /// Make atoms whole, assuming they are in the proper order
   void makeWhole();
 /// Allow calls to modifyGlobalForce()
   void allowToAccessGlobalForces() {atoms.zeroallforces=true;}
+/// Declare that this action modifies with modifyGlobalPosition() the positions of all the atoms,
+/// including the ones it did not request. When the action is active, positions of all the
+/// atoms are then retrieved from the MD code.
+  void allowToModifyGlobalPositions() {modifyglobalpositions=true;}
 /// updates local unique atoms
   void updateUniqueLocal();
 public:
@@ -187,8 +217,9 @@ public:
   void applyForces();
   void lockRequests() override;
   void unlockRequests() override;
-  const std::set<AtomNumber> & getUnique()const;
-  const std::set<AtomNumber> & getUniqueLocal()const;
+  const std::vector<AtomNumber> & getUnique()const;
+  const std::vector<AtomNumber> & getUniqueLocal()const;
+  bool modifiesGlobalPositions()const {return modifyglobalpositions;}
 /// Read in an input file containing atom positions and calculate the action for the atomic
 /// configuration therin
   void readAtomsFromPDB( const PDB& pdb ) override;
@@ -196,7 +227,7 @@ public:
 
 inline
 const Vector & ActionAtomistic::getPosition(int i)const {
-  return positions[i];
+  return positionsData[i];
 }
 
 inline
@@ -242,6 +273,7 @@ AtomNumber ActionAtomistic::getAbsoluteIndex(int i)const {
 
 inline
 const std::vector<Vector> & ActionAtomistic::getPositions()const {
+  plumed_massert(positionsData==positions.data(),"getPositions() cannot be used when positions are not copied");
   return positions;
 }
 
@@ -291,12 +323,12 @@ void ActionAtomistic::unlockRequests() {
 }
 
 inline
-const std::set<AtomNumber> & ActionAtomistic::getUnique()const {
+const std::vector<AtomNumber> & ActionAtomistic::getUnique()const {
   return unique;
 }
 
 inline
-const std::set<AtomNumber> & ActionAtomistic::getUniqueLocal()const {
+const std::vector<AtomNumber> & ActionAtomistic::getUniqueLocal()const {
   return unique_local;
 }
 
@@ -25,6 +25,7 @@
 #include "PlumedMain.h"
 #include "tools/Pbc.h"
 #include <algorithm>
+#include <iterator>
 #include <iostream>
 #include <string>
 #include <cmath>
@@ -41,6 +42,11 @@ class PlumedMain;
 
 Atoms::Atoms(PlumedMain&plumed):
   natoms(0),
+  uniqueHasAllAtoms(false),
+  uniqIndexOK(false),
+  forcedAtomsOK(false),
+  forcedLocalOK(false),
+  forcedAtomsUpdated(false),
   md_energy(0.0),
   energy(0.0),
   dataCanBeSet(false),
@@ -144,51 +150,98 @@ void Atoms::share() {
     return;
   }
 
-  if(!(int(gatindex.size())==natoms && shuffledAtoms==0)) {
-    for(unsigned i=0; i<actions.size(); i++) {
-      if(actions[i]->isActive()) {
-        if(!actions[i]->getUnique().empty()) {
-          atomsNeeded=true;
+// unique only contains the atoms of the actions that are active at this step,
+// so that actions that are not needed (e.g. with a STRIDE) do not cost gathering or communication.
+// it is rebuilt when one of the merged actions is not active anymore.
+// this is decided in the same way on all processes
+  uniqueMerged.resize(actions.size(),false);
+  bool rebuild=uniqueHasAllAtoms;
+  for(unsigned i=0; i<actions.size(); i++) if(uniqueMerged[i] && !actions[i]->isActive()) rebuild=true;
+  if(rebuild) {
+    uniquePrevious.swap(unique);
+    unique.clear();
+    uniqueMerged.assign(uniqueMerged.size(),false);
+    uniqueHasAllAtoms=false;
+  }
+  bool merged=rebuild;
+  int changed=0;
+  for(unsigned i=0; i<actions.size(); i++) {
+    if(actions[i]->isActive()) {
+      if(!actions[i]->getUnique().empty()) {
+        atomsNeeded=true;
+        // unique is only emptied when requests or active actions change, so that the local atoms
+        // of each action have to be merged only once.
+        if(!uniqueMerged[i]) {
+          const unsigned size=unique.size();
           // unique are the local atoms
-          unique.insert(actions[i]->getUniqueLocal().begin(),actions[i]->getUniqueLocal().end());
+          mergeUnique(actions[i]->getUniqueLocal());
+          uniqueMerged[i]=true;
+          merged=true;
+          if(!rebuild && unique.size()!=size) changed=1;
         }
       }
     }
-  } else {
-    for(unsigned i=0; i<actions.size(); i++) {
-      if(actions[i]->isActive()) {
-        if(!actions[i]->getUnique().empty()) {
-          atomsNeeded=true;
-        }
-      }
-    }
-
+  }
+  if(rebuild && unique!=uniquePrevious) changed=1;
+// the exchange plan is kept if the atoms did not change (e.g. when an action with a STRIDE
+// only uses atoms that are already needed by other actions).
+// unique contains the local atoms, so all processes should agree
+  if(merged && dd) dd.Sum(changed);
+  if(changed) {
+    uniqIndexOK=false;
+    dd.planValid=false;
   }
 
   share(unique);
 }
 
-void Atoms::shareAll() {
+void Atoms::clearUnique() {
   unique.clear();
+  uniqueMerged.assign(uniqueMerged.size(),false);
+  uniqIndexOK=false;
+  uniqueHasAllAtoms=false;
+  dd.planValid=false;
+// forcedAtoms has to be rebuilt when forces are updated
+  forcedAtomsOK=false;
+  forcedLocalOK=false;
+}
+
+void Atoms::mergeUnique(const std::vector<AtomNumber>& a) {
+  if(unique.empty()) {
+    unique=a;
+  } else {
+    std::vector<AtomNumber> merged;
+    merged.reserve(unique.size()+a.size());
+    std::set_union(unique.begin(),unique.end(),a.begin(),a.end(),std::back_inserter(merged));
+    unique.swap(merged);
+  }
+}
+
+void Atoms::shareAll() {
+  clearUnique();
   // keep in unique only those atoms that are local
   if(dd && shuffledAtoms>0) {
-    for(int i=0; i<natoms; i++) if(g2l[i]>=0) unique.insert(AtomNumber::index(i));
+    for(int i=0; i<natoms; i++) if(g2l[i]>=0) unique.push_back(AtomNumber::index(i));
   } else {
-    for(int i=0; i<natoms; i++) unique.insert(AtomNumber::index(i));
+    for(int i=0; i<natoms; i++) unique.push_back(AtomNumber::index(i));
   }
+  uniqueHasAllAtoms=true;
   atomsNeeded=true;
   share(unique);
 }
 
-void Atoms::share(const std::set<AtomNumber>& unique) {
+void Atoms::share(const std::vector<AtomNumber>& unique) {
   plumed_assert( positionsHaveBeenSet==3 && massesHaveBeenSet );
 
   virial.zero();
-  if(zeroallforces || int(gatindex.size())==natoms) {
+// only forces of the atoms that received forces at the previous step should be zeroed.
+// if forces were added but forcedAtoms was not updated afterwards all of them are zeroed
+  if(zeroallforces || (!actionsWithForces.empty() && !forcedAtomsUpdated)) {
     for(int i=0; i<natoms; i++) forces[i].zero();
   } else {
-    for(const auto & p : unique) forces[p.index()].zero();
+    for(const auto & p : forcedAtoms) forces[p.index()].zero();
   }
+  actionsWithForces.clear();
   for(unsigned i=getNatoms(); i<positions.size(); i++) forces[i].zero(); // virtual atoms
   forceOnEnergy=0.0;
   mdatoms->getBox(box);
@@ -196,14 +249,22 @@ void Atoms::share(const std::set<AtomNumber>& unique) {
   if(!atomsNeeded) return;
   atomsNeeded=false;
 
-  if(int(gatindex.size())==natoms && shuffledAtoms==0) {
-// faster version, which retrieves all atoms
+  bool retrieveAll=(2*unique.size()>=unsigned(natoms));
+// actions such as FIT_TO_TEMPLATE move all the atoms, so all positions should be up to date
+  for(const auto & a : actions) if(a->isActive() && a->modifiesGlobalPositions()) retrieveAll=true;
+  if(int(gatindex.size())==natoms && shuffledAtoms==0 && retrieveAll) {
+// faster version, which retrieves all atoms. used when most of them are needed
     mdatoms->getPositions(0,natoms,positions);
   } else {
-    uniq_index.clear();
-    uniq_index.reserve(unique.size());
-    if(shuffledAtoms>0) {
-      for(const auto & p : unique) uniq_index.push_back(g2l[p.index()]);
+    if(!uniqIndexOK) {
+      uniq_index.clear();
+      uniq_index.reserve(unique.size());
+      if(shuffledAtoms>0) {
+        for(const auto & p : unique) uniq_index.push_back(g2l[p.index()]);
+      } else {
+        for(const auto & p : unique) uniq_index.push_back(p.index());
+      }
+      uniqIndexOK=true;
     }
     mdatoms->getPositions(unique,uniq_index,positions);
   }
@@ -223,41 +284,52 @@ void Atoms::share(const std::set<AtomNumber>& unique) {
     if(dd.async) {
       for(unsigned i=0; i<dd.mpi_request_positions.size(); i++) dd.mpi_request_positions[i].wait();
       for(unsigned i=0; i<dd.mpi_request_index.size(); i++)     dd.mpi_request_index[i].wait();
+      dd.mpi_request_index.clear();
     }
-    int count=0;
-    for(const auto & p : unique) {
-      dd.indexToBeSent[count]=p.index();
-      dd.positionsToBeSent[ndata*count+0]=positions[p.index()][0];
-      dd.positionsToBeSent[ndata*count+1]=positions[p.index()][1];
-      dd.positionsToBeSent[ndata*count+2]=positions[p.index()][2];
+// the list of atoms to be exchanged is only computed and communicated when it changes.
+// at the other steps only positions are exchanged, using the same order
+    if(!dd.planValid) {
+      int count=0;
+      for(const auto & p : unique) dd.indexToBeSent[count++]=p.index();
+      dd.nsent=count;
+    }
+    const int count=dd.nsent;
+    for(int i=0; i<count; i++) {
+      const int index=dd.indexToBeSent[i];
+      dd.positionsToBeSent[ndata*i+0]=positions[index][0];
+      dd.positionsToBeSent[ndata*i+1]=positions[index][1];
+      dd.positionsToBeSent[ndata*i+2]=positions[index][2];
       if(!massAndChargeOK) {
-        dd.positionsToBeSent[ndata*count+3]=masses[p.index()];
-        dd.positionsToBeSent[ndata*count+4]=charges[p.index()];
+        dd.positionsToBeSent[ndata*i+3]=masses[index];
+        dd.positionsToBeSent[ndata*i+4]=charges[index];
       }
-      count++;
     }
     if(dd.async) {
       asyncSent=true;
+      dd.indexSent=!dd.planValid;
       dd.mpi_request_positions.resize(dd.Get_size());
-      dd.mpi_request_index.resize(dd.Get_size());
+      if(dd.indexSent) dd.mpi_request_index.resize(dd.Get_size());
       for(int i=0; i<dd.Get_size(); i++) {
-        dd.mpi_request_index[i]=dd.Isend(&dd.indexToBeSent[0],count,i,666);
+        if(dd.indexSent) dd.mpi_request_index[i]=dd.Isend(&dd.indexToBeSent[0],count,i,666);
         dd.mpi_request_positions[i]=dd.Isend(&dd.positionsToBeSent[0],ndata*count,i,667);
       }
     } else {
       const int n=(dd.Get_size());
-      vector<int> counts(n);
-      vector<int> displ(n);
+      if(!dd.planValid) {
+        dd.counts.resize(n);
+        dd.displ.resize(n);
+        dd.Allgather(count,dd.counts);
+        dd.displ[0]=0;
+        for(int i=1; i<n; ++i) dd.displ[i]=dd.displ[i-1]+dd.counts[i-1];
+        dd.Allgatherv(&dd.indexToBeSent[0],count,&dd.indexToBeReceived[0],&dd.counts[0],&dd.displ[0]);
+        dd.planValid=true;
+      }
       vector<int> counts5(n);
       vector<int> displ5(n);
-      dd.Allgather(count,counts);
-      displ[0]=0;
-      for(int i=1; i<n; ++i) displ[i]=displ[i-1]+counts[i-1];
-      for(int i=0; i<n; ++i) counts5[i]=counts[i]*ndata;
-      for(int i=0; i<n; ++i) displ5[i]=displ[i]*ndata;
-      dd.Allgatherv(&dd.indexToBeSent[0],count,&dd.indexToBeReceived[0],&counts[0],&displ[0]);
+      for(int i=0; i<n; ++i) counts5[i]=dd.counts[i]*ndata;
+      for(int i=0; i<n; ++i) displ5[i]=dd.displ[i]*ndata;
       dd.Allgatherv(&dd.positionsToBeSent[0],ndata*count,&dd.positionsToBeReceived[0],&counts5[0],&displ5[0]);
-      int tot=displ[n-1]+counts[n-1];
+      int tot=dd.displ[n-1]+dd.counts[n-1];
       for(int i=0; i<tot; i++) {
         positions[dd.indexToBeReceived[i]][0]=dd.positionsToBeReceived[ndata*i+0];
         positions[dd.indexToBeReceived[i]][1]=dd.positionsToBeReceived[ndata*i+1];
@@ -289,12 +361,18 @@ void Atoms::wait() {
     if(asyncSent) {
       Communicator::Status status;
       int count=0;
+      dd.counts.resize(dd.Get_size());
       for(int i=0; i<dd.Get_size(); i++) {
-        dd.Recv(&dd.indexToBeReceived[count],dd.indexToBeReceived.size()-count,i,666,status);
-        int c=status.Get_count<int>();
+        if(dd.indexSent) {
+          dd.Recv(&dd.indexToBeReceived[count],dd.indexToBeReceived.size()-count,i,666,status);
+          dd.counts[i]=status.Get_count<int>();
+        }
+        int c=dd.counts[i];
         dd.Recv(&dd.positionsToBeReceived[ndata*count],dd.positionsToBeReceived.size()-ndata*count,i,667);
         count+=c;
       }
+      if(dd.indexSent) dd.planValid=true;
+      dd.indexSent=false;
       for(int i=0; i<count; i++) {
         positions[dd.indexToBeReceived[i]][0]=dd.positionsToBeReceived[ndata*i+0];
         positions[dd.indexToBeReceived[i]][1]=dd.positionsToBeReceived[ndata*i+1];
@@ -319,9 +397,15 @@ void Atoms::updateForces() {
     double alpha=1.0-forceOnEnergy;
     mdatoms->rescaleForces(gatindex,alpha);
     mdatoms->updateForces(gatindex,forces);
-  } else {
+  } else if(zeroallforces) {
+// forces might have been modified on any atom
     if(int(gatindex.size())==natoms && shuffledAtoms==0) mdatoms->updateForces(gatindex,forces);
     else mdatoms->updateForces(unique,uniq_index,forces);
+  } else {
+// only atoms that received forces are updated
+    updateForcedAtoms();
+    if(int(forcedAtoms.size())==natoms && int(gatindex.size())==natoms && shuffledAtoms==0) mdatoms->updateForces(gatindex,forces);
+    else if(!forcedLocal.empty()) mdatoms->updateForces(forcedLocal,forcedLocalIndex,forces);
   }
   if( !plumed.novirial && dd.Get_rank()==0 ) {
     plumed_assert( virialHasBeenSet );
@@ -329,6 +413,40 @@ void Atoms::updateForces() {
   }
 }
 
+void Atoms::addActionWithForces(const ActionAtomistic*a) {
+  if(actionsWithForces.empty() || actionsWithForces.back()!=a) actionsWithForces.push_back(a);
+  forcedAtomsUpdated=false;
+}
+
+void Atoms::updateForcedAtoms() {
+  if(!forcedAtomsOK || actionsWithForces!=forcedAtomsActions) {
+    forcedAtoms.clear();
+    for(const auto & a : actionsWithForces) {
+      const auto & u(a->getUnique());
+      std::vector<AtomNumber> merged;
+      merged.reserve(forcedAtoms.size()+u.size());
+      std::set_union(forcedAtoms.begin(),forcedAtoms.end(),u.begin(),u.end(),std::back_inserter(merged));
+      forcedAtoms.swap(merged);
+    }
+    forcedAtomsActions=actionsWithForces;
+    forcedAtomsOK=true;
+    forcedLocalOK=false;
+  }
+  if(!forcedLocalOK) {
+    forcedLocal.clear();
+    forcedLocalIndex.clear();
+    for(const auto & p : forcedAtoms) {
+      const int i=(shuffledAtoms>0 ? g2l[p.index()] : p.index());
+      if(i>=0) {
+        forcedLocal.push_back(p);
+        forcedLocalIndex.push_back(i);
+      }
+    }
+    forcedLocalOK=true;
+  }
+  forcedAtomsUpdated=true;
+}
+
 void Atoms::setNatoms(int n) {
   natoms=n;
   positions.resize(n);
@@ -348,6 +466,8 @@ void Atoms::remove(ActionAtomistic*a) {
   auto f=find(actions.begin(),actions.end(),a);
   plumed_massert(f!=actions.end(),"cannot remove an action registered to atoms");
   actions.erase(f);
+// uniqueMerged is indexed by the position of the action
+  clearUnique();
 }
 
 
@@ -365,6 +485,7 @@ void Atoms::DomainDecomposition::enable(Communicator& c) {
 
 void Atoms::setAtomsNlocal(int n) {
   gatindex.resize(n);
+  dd.planValid=false;
   g2l.resize(natoms,-1);
   if(dd) {
 // Since these vectors are sent with MPI by using e.g.
@@ -405,7 +526,7 @@ void Atoms::setAtomsGatindex(int*g,bool fortran) {
     // keep in unique only those atoms that are local
     actions[i]->updateUniqueLocal();
   }
-  unique.clear();
+  clearUnique();
 }
 
 void Atoms::setAtomsContiguous(int start) {
@@ -418,7 +539,7 @@ void Atoms::setAtomsContiguous(int start) {
     // keep in unique only those atoms that are local
     actions[i]->updateUniqueLocal();
   }
-  unique.clear();
+  clearUnique();
 }
 
 void Atoms::setRealPrecision(int p) {
@@ -466,13 +587,13 @@ void Atoms::createFullList(int*n) {
 // We update here the unique list defined at Atoms::unique.
 // This is not very clear, and probably should be coded differently.
 // Hopefully this fix the longstanding issue with NAMD.
-    unique.clear();
+    clearUnique();
     for(unsigned i=0; i<actions.size(); i++) {
       if(actions[i]->isActive()) {
         if(!actions[i]->getUnique().empty()) {
           atomsNeeded=true;
           // unique are the local atoms
-          unique.insert(actions[i]->getUnique().begin(),actions[i]->getUnique().end());
+          mergeUnique(actions[i]->getUnique());
         }
       }
     }
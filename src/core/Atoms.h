@@ -49,8 +49,44 @@ class Atoms
   friend class ActionAtomistic;
   friend class ActionWithVirtualAtom;
   int natoms;
-  std::set<AtomNumber> unique;
+/// Sorted list of the local atoms of the active actions, that are shared with the MD code.
+/// It is only rebuilt when the requests or the active actions change, see clearUnique()
+  std::vector<AtomNumber> unique;
+/// For each action, true if its local atoms have already been merged in unique
+  std::vector<bool> uniqueMerged;
+/// True if unique contains all the atoms, as set by shareAll()
+  bool uniqueHasAllAtoms;
+/// Content of unique before it was last rebuilt, used to check whether it changed
+  std::vector<AtomNumber> uniquePrevious;
+/// Empty unique. Should be called whenever the requested atoms or
+/// their distribution among processes change
+  void clearUnique();
+/// Merge a sorted list of atoms into unique
+  void mergeUnique(const std::vector<AtomNumber>&);
+/// Position in the MD arrays of the atoms in unique
   std::vector<unsigned> uniq_index;
+/// True if uniq_index corresponds to unique
+  bool uniqIndexOK;
+/// Actions that added non-zero forces to their atoms at this step
+  std::vector<const ActionAtomistic*> actionsWithForces;
+/// Actions whose atoms are listed in forcedAtoms
+  std::vector<const ActionAtomistic*> forcedAtomsActions;
+/// Sorted list of the real atoms that received forces.
+/// It is used to update forces in the MD code and to zero them at the following step.
+  std::vector<AtomNumber> forcedAtoms;
+/// Local atoms in forcedAtoms, and their position in the MD arrays
+  std::vector<AtomNumber> forcedLocal;
+  std::vector<unsigned> forcedLocalIndex;
+/// True if forcedAtoms corresponds to the atoms currently requested by forcedAtomsActions
+  bool forcedAtomsOK;
+/// True if forcedLocal and forcedLocalIndex correspond to forcedAtoms
+  bool forcedLocalOK;
+/// True if forcedAtoms includes the atoms of all the actions that added forces at this step
+  bool forcedAtomsUpdated;
+/// Record that an action added non-zero forces to its atoms
+  void addActionWithForces(const ActionAtomistic*);
+/// Rebuild forcedAtoms if the actions that applied forces or their atoms changed
+  void updateForcedAtoms();
 /// Map global indexes to local indexes
 /// E.g. g2l[i] is the position of atom i in the array passed from the MD engine.
 /// Called "global to local" since originally it was used to map global indexes to local
@@ -129,9 +165,20 @@ class Atoms
     std::vector<double> positionsToBeReceived;
     std::vector<int>    indexToBeSent;
     std::vector<int>    indexToBeReceived;
+/// True if indexToBeSent, indexToBeReceived and counts are up to date.
+/// In this case only positions are exchanged. It is invalidated when the
+/// requested atoms change or when atoms are redistributed by the MD code.
+    bool planValid;
+/// True if indexes have been sent asynchronously at this step
+    bool indexSent;
+/// Number of local atoms sent by this process
+    int nsent;
+/// Number of atoms received from each process, and their offset
+    std::vector<int> counts;
+    std::vector<int> displ;
     operator bool() const {return on;}
     DomainDecomposition():
-      on(false), async(false)
+      on(false), async(false), planValid(false), indexSent(false), nsent(0)
     {}
     void enable(Communicator& c);
   };
@@ -139,7 +186,7 @@ class Atoms
   DomainDecomposition dd;
   long int ddStep;  //last step in which dd happened
 
-  void share(const std::set<AtomNumber>&);
+  void share(const std::vector<AtomNumber>&);
 
 public:
 
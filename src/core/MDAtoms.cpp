@@ -86,14 +86,14 @@ public:
   }
   void getBox(Tensor &) const override;
   void getPositions(const vector<int>&index,vector<Vector>&positions) const override;
-  void getPositions(const std::set<AtomNumber>&index,const vector<unsigned>&i,vector<Vector>&positions) const override;
+  void getPositions(const std::vector<AtomNumber>&index,const vector<unsigned>&i,vector<Vector>&positions) const override;
   void getPositions(unsigned j,unsigned k,vector<Vector>&positions) const override;
   void getLocalPositions(std::vector<Vector>&p) const override;
   void getMasses(const vector<int>&index,vector<double>&) const override;
   void getCharges(const vector<int>&index,vector<double>&) const override;
   void updateVirial(const Tensor&) const override;
   void updateForces(const vector<int>&index,const vector<Vector>&) override;
-  void updateForces(const std::set<AtomNumber>&index,const vector<unsigned>&i,const vector<Vector>&forces) override;
+  void updateForces(const std::vector<AtomNumber>&index,const vector<unsigned>&i,const vector<Vector>&forces) override;
   void rescaleForces(const vector<int>&index,double factor) override;
   unsigned  getRealPrecision()const override;
 };
@@ -131,7 +131,7 @@ void MDAtomsTyped<T>::getPositions(const vector<int>&index,vector<Vector>&positi
 }
 
 template <class T>
-void MDAtomsTyped<T>::getPositions(const std::set<AtomNumber>&index,const vector<unsigned>&i, vector<Vector>&positions)const {
+void MDAtomsTyped<T>::getPositions(const std::vector<AtomNumber>&index,const vector<unsigned>&i, vector<Vector>&positions)const {
 // cannot be parallelized with omp because access to positions is not ordered
   unsigned k=0;
   for(const auto & p : index) {
@@ -182,7 +182,7 @@ void MDAtomsTyped<T>::updateVirial(const Tensor&virial)const {
 }
 
 template <class T>
-void MDAtomsTyped<T>::updateForces(const std::set<AtomNumber>&index,const vector<unsigned>&i,const vector<Vector>&forces) {
+void MDAtomsTyped<T>::updateForces(const std::vector<AtomNumber>&index,const vector<unsigned>&i,const vector<Vector>&forces) {
   unsigned k=0;
   for(const auto & p : index) {
     fx[stride*i[k]]+=scalef*T(forces[p.index()][0]);
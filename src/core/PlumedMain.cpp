@@ -147,6 +147,8 @@ PlumedMain::PlumedMain():
 
 // destructor needed to delete forward declarated objects
 PlumedMain::~PlumedMain() {
+// make sure that a calculation running in background does not outlive the actions
+  if(asyncCalc.valid()) asyncCalc.wait();
 }
 
 /////////////////////////////////////////////////////////////
@@ -182,6 +184,7 @@ void PlumedMain::cmd(const std::string & word,void*val) {
       double d;
       const auto it=word_map.find(words[0]);
       if(it!=word_map.end()) iword=it->second;
+      plumed_massert(!asyncCalc.valid() || iword==cmd_waitCalc,"cmd(\"waitCalc\") should be called after cmd(\"startCalc\") and before any other command");
       switch(iword) {
       case cmd_setBox:
         CHECK_INIT(initialized,word);
@@ -262,6 +265,14 @@ void PlumedMain::cmd(const std::string & word,void*val) {
         CHECK_INIT(initialized,word);
         performCalcNoUpdate();
         break;
+      case cmd_startCalc:
+        CHECK_INIT(initialized,word);
+        startCalc();
+        break;
+      case cmd_waitCalc:
+        CHECK_INIT(initialized,word);
+        waitCalc();
+        break;
       case cmd_update:
         CHECK_INIT(initialized,word);
         update();
@@ -352,7 +363,7 @@ void PlumedMain::cmd(const std::string & word,void*val) {
         break;
       case cmd_getApiVersion:
         CHECK_NOTNULL(val,word);
-        *(static_cast<int*>(val))=7;
+        *(static_cast<int*>(val))=8;
         break;
       // commands which can be used only before initialization:
       case cmd_init:
@@ -763,6 +774,84 @@ void PlumedMain::waitData() {
   if(atoms.getNatoms()>0) atoms.wait();
 }
 
+namespace {
+
+/// Run f on the active actions from first to last-1 using OpenMP threads.
+/// If some of them throws, the exception of the first action in the list is rethrown.
+template<typename F>
+void runConcurrently(ActionSet & actionSet,unsigned first,unsigned last,F f) {
+  unsigned nt=OpenMP::getNumThreads();
+  if(nt>last-first) nt=last-first;
+  std::exception_ptr except;
+  unsigned iexcept=last;
+  #pragma omp parallel for num_threads(nt) schedule(dynamic)
+  for(unsigned i=first; i<last; i++) {
+    Action* p(actionSet[i].get());
+    if(!p->isActive()) continue;
+    try {
+      f(p);
+    } catch(...) {
+      #pragma omp critical
+      if(i<iexcept) {
+        except=std::current_exception();
+        iexcept=i;
+      }
+    }
+  }
+  if(except) std::rethrow_exception(except);
+}
+
+/// Number of an action, padded with spaces so that detailed timers are sorted correctly
+std::string actionNumberLabel(unsigned iaction,unsigned nactions) {
+  std::string label;
+  Tools::convert(iaction,label);
+  unsigned k=0; unsigned n=1; while(n<nactions) { n*=10; k++; }
+  const int pad=k-label.length();
+  for(int i=0; i<pad; i++) label=" "+label;
+  return label;
+}
+
+/// Prepare an action and calculate it
+void calculateAction(Action* p) {
+  ActionWithValue*av=dynamic_cast<ActionWithValue*>(p);
+  ActionAtomistic*aa=dynamic_cast<ActionAtomistic*>(p);
+  {
+    if(av) av->clearInputForces();
+    if(av) av->clearDerivatives();
+  }
+  {
+    if(aa) aa->clearOutputForces();
+    if(aa) if(aa->isActive()) aa->retrieveAtoms();
+  }
+  if(p->checkNumericalDerivatives()) p->calculateNumericalDerivatives();
+  else p->calculate();
+}
+
+}
+
+void PlumedMain::updateActionGroups() {
+  actionGroups.clear();
+// actions are only run concurrently with multiple threads and if they are not timed individually
+  const bool concurrent=OpenMP::getNumThreads()>1 && !detailedTimers;
+  auto canJoin=[](Action* p) {
+    return !p->isActive() || (p->canBeCalculatedConcurrently() && !p->checkNumericalDerivatives());
+  };
+  unsigned first=0;
+  for(unsigned i=0; i<actionSet.size(); i++) {
+    Action* p(actionSet[i].get());
+    bool join=concurrent && i>first && canJoin(p) && canJoin(actionSet[first].get());
+// an action cannot be in the same group of an action it depends on
+    if(join) for(const auto & d : p->getDependencies()) {
+        for(unsigned j=first; j<i; j++) if(actionSet[j].get()==d) join=false;
+      }
+    if(!join) {
+      actionGroups.push_back(i);
+      first=i;
+    }
+  }
+  actionGroups.push_back(actionSet.size());
+}
+
 void PlumedMain::justCalculate() {
   if(!active)return;
 // Stopwatch is stopped when sw goes out of scope
@@ -770,35 +859,27 @@ void PlumedMain::justCalculate() {
   bias=0.0;
   work=0.0;
 
-  int iaction=0;
+  updateActionGroups();
 // calculate the active actions in order (assuming *backward* dependence)
-  for(const auto & pp : actionSet) {
-    Action* p(pp.get());
-    if(p->isActive()) {
+// actions in the same group are independent and are calculated concurrently
+  for(unsigned g=0; g+1<actionGroups.size(); g++) {
+    const unsigned first=actionGroups[g];
+    const unsigned last=actionGroups[g+1];
+    if(last-first>1) runConcurrently(actionSet,first,last,calculateAction);
+    for(unsigned iaction=first; iaction<last; iaction++) {
+      Action* p(actionSet[iaction].get());
+      if(!p->isActive()) continue;
+      if(last-first==1) {
 // Stopwatch is stopped when sw goes out of scope.
 // We explicitly declare a Stopwatch::Handler here to allow for conditional initialization.
-      Stopwatch::Handler sw;
-      if(detailedTimers) {
-        std::string actionNumberLabel;
-        Tools::convert(iaction,actionNumberLabel);
-        const unsigned m=actionSet.size();
-        unsigned k=0; unsigned n=1; while(n<m) { n*=10; k++; }
-        const int pad=k-actionNumberLabel.length();
-        for(int i=0; i<pad; i++) actionNumberLabel=" "+actionNumberLabel;
-        sw=stopwatch.startStop("4A "+actionNumberLabel+" "+p->getLabel());
+        Stopwatch::Handler sw;
+        if(detailedTimers) {
+          sw=stopwatch.startStop("4A "+actionNumberLabel(iaction,actionSet.size())+" "+p->getLabel());
+        }
+        calculateAction(p);
       }
+// results are collected in order, so that they do not depend on the number of threads
       ActionWithValue*av=dynamic_cast<ActionWithValue*>(p);
-      ActionAtomistic*aa=dynamic_cast<ActionAtomistic*>(p);
-      {
-        if(av) av->clearInputForces();
-        if(av) av->clearDerivatives();
-      }
-      {
-        if(aa) aa->clearOutputForces();
-        if(aa) if(aa->isActive()) aa->retrieveAtoms();
-      }
-      if(p->checkNumericalDerivatives()) p->calculateNumericalDerivatives();
-      else p->calculate();
       // This retrieves components called bias
       if(av) bias+=av->getOutputQuantity("bias");
       if(av) work+=av->getOutputQuantity("work");
@@ -806,7 +887,6 @@ void PlumedMain::justCalculate() {
       ActionWithVirtualAtom*avv=dynamic_cast<ActionWithVirtualAtom*>(p);
       if(avv)avv->setGradientsIfNeeded();
     }
-    iaction++;
   }
 }
 
@@ -817,36 +897,40 @@ void PlumedMain::justApply() {
 
 void PlumedMain::backwardPropagate() {
   if(!active)return;
-  int iaction=0;
 // Stopwatch is stopped when sw goes out of scope
   auto sw=stopwatch.startStop("5 Applying (backward loop)");
-// apply them in reverse order
-  for(auto pp=actionSet.rbegin(); pp!=actionSet.rend(); ++pp) {
-    const auto & p(pp->get());
-    if(p->isActive()) {
+  applyActions();
+  updateForces();
+}
 
+void PlumedMain::applyActions() {
+  updateActionGroups();
+// apply them in reverse order
+// actions in the same group compute their forces concurrently, and then add them to atoms in order
+  for(unsigned g=actionGroups.size()-1; g>0; g--) {
+    const unsigned first=actionGroups[g-1];
+    const unsigned last=actionGroups[g];
+    if(last-first>1) runConcurrently(actionSet,first,last,[](Action* p) {p->apply();});
+    for(unsigned iaction=last; iaction>first; iaction--) {
+      Action* p(actionSet[iaction-1].get());
+      if(!p->isActive()) continue;
+      if(last-first==1) {
 // Stopwatch is stopped when sw goes out of scope.
 // We explicitly declare a Stopwatch::Handler here to allow for conditional initialization.
-      Stopwatch::Handler sw;
-      if(detailedTimers) {
-        std::string actionNumberLabel;
-        Tools::convert(iaction,actionNumberLabel);
-        const unsigned m=actionSet.size();
-        unsigned k=0; unsigned n=1; while(n<m) { n*=10; k++; }
-        const int pad=k-actionNumberLabel.length();
-        for(int i=0; i<pad; i++) actionNumberLabel=" "+actionNumberLabel;
-        sw=stopwatch.startStop("5A "+actionNumberLabel+" "+p->getLabel());
+        Stopwatch::Handler sw;
+        if(detailedTimers) {
+          sw=stopwatch.startStop("5A "+actionNumberLabel(actionSet.size()-iaction,actionSet.size())+" "+p->getLabel());
+        }
+        p->apply();
       }
-
-      p->apply();
       ActionAtomistic*a=dynamic_cast<ActionAtomistic*>(p);
 // still ActionAtomistic has a special treatment, since they may need to add forces on atoms
       if(a) a->applyForces();
-
     }
-    iaction++;
   }
+}
 
+void PlumedMain::updateForces() {
 // Stopwatch is stopped when sw goes out of scope.
 // We explicitly declare a Stopwatch::Handler here to allow for conditional initialization.
   Stopwatch::Handler sw1;
@@ -855,6 +939,40 @@ void PlumedMain::backwardPropagate() {
   if(atoms.getNatoms()>0) atoms.updateForces();
 }
 
+void PlumedMain::startCalc() {
+  prepareCalc();
+// after this, positions are stored in PLUMED and the MD arrays are not read anymore
+  waitData();
+  if(!active)return;
+  auto calculate=[this]() {
+    justCalculate();
+// Stopwatch is stopped when sw goes out of scope
+    auto sw=stopwatch.startStop("5 Applying (backward loop)");
+    applyActions();
+  };
+// communications are not done in background since MPI might not be thread safe.
+// detailed timers are also excluded since they would add watches while the MD code might call cmd
+  if(comm.Get_size()==1 && multi_sim_comm.Get_size()==1 && !detailedTimers) {
+// create the watches used in the background thread here, so that the list of watches
+// is never modified concurrently
+    for(const auto & w : {"4 Calculating (forward loop)","5 Applying (backward loop)"}) {
+      stopwatch.start(w);
+      stopwatch.pause(w);
+    }
+    asyncCalc=std::async(std::launch::async,calculate);
+  } else {
+    calculate();
+  }
+}
+
+void PlumedMain::waitCalc() {
+// exceptions raised in the background thread are rethrown here
+  if(asyncCalc.valid()) asyncCalc.get();
+  if(active) updateForces();
+  update();
+  mydatafetcher->finishDataGrab();
+}
+
 void PlumedMain::update() {
   if(!active)return;
 
@@ -863,9 +981,16 @@ void PlumedMain::update() {
 
 // update step (for statistics, etc)
   updateFlags.push(true);
-  for(const auto & p : actionSet) {
+  for(unsigned iaction=0; iaction<actionSet.size(); iaction++) {
+    Action* p(actionSet[iaction].get());
     p->beforeUpdate();
-    if(p->isActive() && p->checkUpdate() && updateFlagsTop()) p->update();
+    if(p->isActive() && p->checkUpdate() && updateFlagsTop()) {
+// Stopwatch is stopped when sw goes out of scope.
+// We explicitly declare a Stopwatch::Handler here to allow for conditional initialization.
+      Stopwatch::Handler sw;
+      if(detailedTimers) sw=stopwatch.startStop("6A "+actionNumberLabel(iaction,actionSet.size())+" "+p->getLabel());
+      p->update();
+    }
   }
   while(!updateFlags.empty()) updateFlags.pop();
   if(!updateFlags.empty()) plumed_merror("non matching changes in the update flags");
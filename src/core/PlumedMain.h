@@ -31,6 +31,7 @@
 #include <stack>
 #include <memory>
 #include <map>
+#include <future>
 
 // !!!!!!!!!!!!!!!!!!!!!!    DANGER   !!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!11
 // THE FOLLOWING ARE DEFINITIONS WHICH ARE NECESSARY FOR DYNAMIC LOADING OF THE PLUMED KERNEL:
@@ -199,6 +200,16 @@ private:
 /// Store information used in class \ref generic::UpdateIf
   std::stack<bool> updateFlags;
 
+/// Boundaries of the groups of consecutive actions that are calculated and applied concurrently.
+/// Group k contains actions from actionGroups[k] to actionGroups[k+1]-1
+  std::vector<unsigned> actionGroups;
+
+/// Split the actions in groups of independent actions that can be calculated concurrently
+  void updateActionGroups();
+
+/// Calculation started with startCalc() and running in background
+  std::future<void> asyncCalc;
+
 public:
 /// Flag to switch off virial calculation (for debug and MD codes with no barostat)
   bool novirial;
@@ -318,6 +329,27 @@ public:
     Needed to apply the forces back.
   */
   void backwardPropagate();
+  /**
+    Apply the active actions in backward order, without updating the MD copy of the forces.
+  */
+  void applyActions();
+  /**
+    Add the forces computed by PLUMED to the MD copy of the forces.
+  */
+  void updateForces();
+  /**
+    Start the calculation.
+    This shares the atoms, so that the MD code is allowed to modify its arrays as soon as this call returns,
+    and then calculates and applies the active actions. When possible, this is done in a background thread,
+    so that the MD code can compute its own forces in the meanwhile.
+    No other command should be issued before calling waitCalc().
+  */
+  void startCalc();
+  /**
+    Wait for the calculation started with startCalc(), add the forces to the MD copy and call update().
+    After this call, forces, virial and bias are available to the MD code.
+  */
+  void waitCalc();
   /**
     Call the update() method.
   */
@@ -333,6 +365,8 @@ public:
   const ActionSet & getActionSet()const;
 /// Referenge to the log stream
   Log & getLog();
+/// Reference to the stopwatch used to time the calculation
+  Stopwatch & getStopwatch() {return stopwatch;}
 /// Return the number of the step
   long int getStep()const {return step;}
 /// Stop the run
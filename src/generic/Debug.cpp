@@ -23,6 +23,11 @@
 #include "core/ActionPilot.h"
 #include "core/ActionSet.h"
 #include "core/PlumedMain.h"
+#include "tools/Stopwatch.h"
+#include "tools/Communicator.h"
+#include <algorithm>
+#include <cmath>
+#include <set>
 
 using namespace std;
 
@@ -44,6 +49,30 @@ DEBUG DETAILED_TIMERS
 DEBUG logRequestedAtoms STRIDE=2
 \endplumedfile
 
+Detailed timers can also be written periodically on a file in CSV format,
+so that they can be analyzed during the simulation. Every STRIDE steps, a line is
+written for each timer and each MPI process, containing the statistics of the laps
+completed since the previous output: number of cycles, total time, average, minimum,
+median, 90th and 99th percentiles and maximum. Times are in seconds.
+Timers named "4A", "5A" and "6A" are respectively the time spent by each action
+in calculate(), apply() and update().
+
+Hardware counters (cycles, instructions, cache misses and branch misses) can be recorded
+together with detailed timers using the PERF_COUNTERS flag. They are written in the log at the
+end of the simulation, and can be used to understand if an action is limited by memory access
+(low number of instructions per cycle and many cache misses) or by computation.
+Only the thread calling PLUMED is counted, so the work done by OpenMP threads is not included.
+Counters are read with the perf_event_open system call, which is only available on Linux and might be
+restricted by the system administrator (see /proc/sys/kernel/perf_event_paranoid).
+If they cannot be read, a message is written in the log and the simulation continues without them.
+
+\plumedfile
+# write detailed timers every 1000 steps on file timers.csv
+DEBUG DETAILED_TIMERS_FILE=timers.csv STRIDE=1000
+# record hardware counters for each action
+DEBUG PERF_COUNTERS
+\endplumedfile
+
 */
 //+ENDPLUMEDOC
 class Debug:
@@ -54,12 +83,15 @@ class Debug:
   bool logRequestedAtoms;
   bool novirial;
   bool detailedTimers;
+  OFile timersFile;
+  bool timersOnFile;
 public:
   explicit Debug(const ActionOptions&ao);
 /// Register all the relevant keywords for the action
   static void registerKeywords( Keywords& keys );
   void calculate() override {}
   void apply() override;
+  void update() override;
 };
 
 PLUMED_REGISTER_ACTION(Debug,"DEBUG")
@@ -73,6 +105,8 @@ void Debug::registerKeywords( Keywords& keys ) {
   keys.addFlag("NOVIRIAL",false,"switch off the virial contribution for the entirety of the simulation");
   keys.addFlag("DETAILED_TIMERS",false,"switch on detailed timers");
   keys.add("optional","FILE","the name of the file on which to output these quantities");
+  keys.addFlag("PERF_COUNTERS",false,"switch on detailed timers and record hardware counters for each of them (only available on Linux)");
+  keys.add("optional","DETAILED_TIMERS_FILE","switch on detailed timers and write their statistics every STRIDE steps on this file, in CSV format");
 }
 
 Debug::Debug(const ActionOptions&ao):
@@ -80,7 +114,8 @@ Debug::Debug(const ActionOptions&ao):
   ActionPilot(ao),
   logActivity(false),
   logRequestedAtoms(false),
-  novirial(false) {
+  novirial(false),
+  timersOnFile(false) {
   parseFlag("logActivity",logActivity);
   if(logActivity) log.printf("  logging activity\n");
   parseFlag("logRequestedAtoms",logRequestedAtoms);
@@ -93,6 +128,25 @@ Debug::Debug(const ActionOptions&ao):
     log.printf("  Detailed timing on\n");
     plumed.detailedTimers=true;
   }
+  bool perfCounters=false;
+  parseFlag("PERF_COUNTERS",perfCounters);
+  if(perfCounters) {
+    plumed.detailedTimers=true;
+    std::string error=plumed.getStopwatch().recordPerfCounters();
+    if(error.length()>0) log.printf("  Hardware counters are not available (%s), only timings will be recorded\n",error.c_str());
+    else log.printf("  Recording hardware counters\n");
+  }
+  std::string timersFileName;
+  parse("DETAILED_TIMERS_FILE",timersFileName);
+  if(timersFileName.length()>0) {
+    timersOnFile=true;
+    log.printf("  Detailed timers written on file %s\n",timersFileName.c_str());
+    plumed.detailedTimers=true;
+    plumed.getStopwatch().recordLaps(true);
+    timersFile.link(*this);
+    timersFile.open(timersFileName);
+    timersFile.printf("step,time,rank,timer,cycles,total,average,min,p50,p90,p99,max\n");
+  }
   ofile.link(*this);
   std::string file;
   parse("FILE",file);
@@ -137,6 +191,85 @@ void Debug::apply() {
 
 }
 
-}
+void Debug::update() {
+  if(!timersOnFile) return;
+  std::map<std::string,std::vector<long long int>> laps;
+  plumed.getStopwatch().takeLaps(laps);
+
+// statistics are computed on each process and then collected, so that they can be written by the first one
+  const unsigned nstat=7;
+  const unsigned nranks=comm.Get_size();
+  const unsigned rank=comm.Get_rank();
+// timers can be different on different processes (e.g. when some actions are only used on some of them),
+// so their names are collected from all the processes and the statistics are merged by name
+  std::set<std::string> names;
+  for(const auto & l : laps) names.insert(l.first);
+  if(nranks>1) {
+    std::string local;
+    for(const auto & l : laps) {
+      local+=l.first;
+      local+='\0';
+    }
+    std::vector<int> counts(nranks,0),displs(nranks,0);
+    counts[rank]=local.size();
+    comm.Sum(counts);
+    for(unsigned r=1; r<nranks; r++) displs[r]=displs[r-1]+counts[r-1];
+    std::vector<char> all(displs[nranks-1]+counts[nranks-1]);
+    if(all.size()>0) {
+      std::copy(local.begin(),local.end(),all.begin()+displs[rank]);
+      comm.Allgatherv(static_cast<const char*>(NULL),counts[rank],&all[0],&counts[0],&displs[0]);
+    }
+    for(unsigned i=0; i<all.size();) {
+      std::string name(&all[i]);
+      i+=name.length()+1;
+      names.insert(name);
+    }
+  }
+  std::map<std::string,unsigned> index;
+  for(const auto & n : names) index.insert(std::make_pair(n,index.size()));
+  const unsigned ntimers=names.size();
+  std::vector<double> stat(nranks*ntimers*nstat,0.0);
+  const double frac=1.0/1000000000.0;
+  for(auto & l : laps) {
+    auto & t(l.second);
+    double* s=&stat[(index[l.first]*nranks+rank)*nstat];
+    if(t.size()>0) {
+      std::sort(t.begin(),t.end());
+      long long int total=0;
+      for(const auto & x : t) total+=x;
+// nearest-rank percentile
+      auto percentile=[&t](double p) {
+        unsigned i=std::ceil(p*t.size());
+        if(i>0) i--;
+        return t[i];
+      };
+      s[0]=t.size();
+      s[1]=frac*total;
+      s[2]=frac*t[0];
+      s[3]=frac*percentile(0.5);
+      s[4]=frac*percentile(0.9);
+      s[5]=frac*percentile(0.99);
+      s[6]=frac*t.back();
+    }
+  }
+  comm.Sum(stat);
+
+  unsigned itimer=0;
+  for(const auto & name : names) {
+    const double* s=&stat[itimer*nranks*nstat];
+    itimer++;
+    double cycles=0.0;
+    for(unsigned r=0; r<nranks; r++) cycles+=s[r*nstat];
+// timers with no completed lap in this interval (e.g. the total time) are not written
+    if(cycles==0.0) continue;
+    for(unsigned r=0; r<nranks; r++) {
+      const double* sr=s+r*nstat;
+      timersFile.printf("%ld,%f,%u,\"%s\",%.0f,%.9f,%.9f,%.9f,%.9f,%.9f,%.9f,%.9f\n",
+                        getStep(),getTime(),r,name.c_str(),sr[0],sr[1],(sr[0]>0.0?sr[1]/sr[0]:0.0),sr[2],sr[3],sr[4],sr[5],sr[6]);
+    }
+  }
+  timersFile.flush();
 }
 
+}
+}
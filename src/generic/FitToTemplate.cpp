@@ -288,6 +288,8 @@ FitToTemplate::FitToTemplate(const ActionOptions&ao):
   // this is required so as to allow modifyGlobalForce() to return correct
   // also for forces that are not owned (and thus not zeored) by all processors.
   allowToAccessGlobalForces();
+  // all the atoms are moved, so their positions should be retrieved even if they were not requested
+  allowToModifyGlobalPositions();
 }
 
 
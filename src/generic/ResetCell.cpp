@@ -128,6 +128,9 @@ ResetCell::ResetCell(const ActionOptions&ao):
   log<<"  type: "<<type<<"\n";
   if(type!="TRIANGULAR") error("undefined type "+type);
 
+  // all the atoms are rotated, so their positions should be retrieved even if they were not requested
+  allowToModifyGlobalPositions();
+
   checkRead();
 }
 
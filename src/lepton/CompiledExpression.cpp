@@ -67,6 +67,7 @@
 #ifdef __PLUMED_HAS_ASMJIT
     #include "asmjit/asmjit.h"
 #endif
+#include <cstdint>
 #include <utility>
 
 namespace PLMD {
@@ -106,13 +107,25 @@ AsmJitRuntimePtr::~AsmJitRuntimePtr()
 #endif
 }
 
-CompiledExpression::CompiledExpression() : jitCode(NULL) {
+CompiledExpression::CompiledExpression() : jitCode(NULL), batchJitGenerated(false) {
 }
 
-CompiledExpression::CompiledExpression(const ParsedExpression& expression) : jitCode(NULL) {
-    ParsedExpression expr = expression.optimize(); // Just in case it wasn't already optimized.
+CompiledExpression::CompiledExpression(const ParsedExpression& expression) : CompiledExpression(vector<ParsedExpression>(1, expression)) {
+}
+
+CompiledExpression::CompiledExpression(const vector<ParsedExpression>& expressions) : jitCode(NULL), batchJitGenerated(false) {
+    if (expressions.size() == 0)
+        throw Exception("CompiledExpression: at least one expression is required");
+
+    // All the expressions share the same temporaries, so that identical subexpressions are only evaluated once.
+
     vector<pair<ExpressionTreeNode, int> > temps;
-    compileExpression(expr.getRootNode(), temps);
+    for (int i = 0; i < (int) expressions.size(); i++) {
+        ParsedExpression expr = expressions[i].optimize(); // Just in case it wasn't already optimized.
+        compileExpression(expr.getRootNode(), temps);
+        results.push_back(findTempIndex(expr.getRootNode(), temps));
+    }
+    resultValues.resize(results.size());
     int maxArguments = 1;
     for (int i = 0; i < (int) operation.size(); i++)
         if (operation[i]->getNumArguments() > maxArguments)
@@ -129,7 +142,7 @@ CompiledExpression::~CompiledExpression() {
             delete operation[i];
 }
 
-CompiledExpression::CompiledExpression(const CompiledExpression& expression) : jitCode(NULL) {
+CompiledExpression::CompiledExpression(const CompiledExpression& expression) : jitCode(NULL), batchJitGenerated(false) {
     *this = expression;
 }
 
@@ -138,11 +151,15 @@ CompiledExpression& CompiledExpression::operator=(const CompiledExpression& expr
     target = expression.target;
     variableIndices = expression.variableIndices;
     variableNames = expression.variableNames;
+    results = expression.results;
+    resultValues.resize(expression.resultValues.size());
     workspace.resize(expression.workspace.size());
     argValues.resize(expression.argValues.size());
     operation.resize(expression.operation.size());
     for (int i = 0; i < (int) operation.size(); i++)
         operation[i] = expression.operation[i]->clone();
+    batchJitCode.clear();
+    batchJitGenerated = false;
     setVariableLocations(variablePointers);
     return *this;
 }
@@ -252,7 +269,198 @@ double CompiledExpression::evaluate() const {
             workspace[target[step]] = operation[step]->evaluate(&argValues[0], dummyVariables);
         }
     }
-    return workspace[workspace.size()-1];
+    for (int i = 0; i < (int) results.size(); i++)
+        resultValues[i] = workspace[results[i]];
+    return resultValues[0];
+}
+
+double CompiledExpression::getResult(int index) const {
+    return resultValues[index];
+}
+
+// Get the value of the constant used by a CONSTANT, ADD_CONSTANT or MULTIPLY_CONSTANT operation.
+static double getConstantValue(const Operation& op) {
+    if (op.getId() == Operation::CONSTANT)
+        return dynamic_cast<const Operation::Constant&>(op).getValue();
+    if (op.getId() == Operation::ADD_CONSTANT)
+        return dynamic_cast<const Operation::AddConstant&>(op).getValue();
+    return dynamic_cast<const Operation::MultiplyConstant&>(op).getValue();
+}
+
+void CompiledExpression::evaluate(int n, const vector<const double*>& variables, const vector<int>& strides, double* result) const {
+    evaluateBlocks(n, variables, strides, &result, 1);
+}
+
+void CompiledExpression::evaluate(int n, const vector<const double*>& variables, const vector<int>& strides, const vector<double*>& result) const {
+    if (result.size() > results.size())
+        throw Exception("evaluate: more results requested than the number of expressions");
+    if (result.size() > 0)
+        evaluateBlocks(n, variables, strides, &result[0], (int) result.size());
+}
+
+void CompiledExpression::evaluateBlocks(int n, const vector<const double*>& variables, const vector<int>& strides, double* const* result, int numResults) const {
+    if (variables.size() != variableNames.size() || strides.size() != variableNames.size())
+        throw Exception("evaluate: the number of variables does not match the expression");
+#ifdef __PLUMED_HAS_ASMJIT
+    // The code for batches does not depend on the variable locations, so it is generated only once, when it is first needed.
+
+    static const bool asmjit=useAsmJit();
+    if (asmjit && !batchJitGenerated) {
+        generateBatchJitCode();
+        batchJitGenerated = true;
+    }
+#endif
+    const int size = (int) workspace.size();
+    batchWorkspace.resize(size*batchSize);
+    for (int start = 0; start < n; start += batchSize) {
+        const int count = (n-start < batchSize ? n-start : batchSize);
+
+        // Copy the values of the variables to the workspace.
+
+        int v = 0;
+        for (set<string>::const_iterator iter = variableNames.begin(); iter != variableNames.end(); ++iter, ++v) {
+            double* row = &batchWorkspace[variableIndices.find(*iter)->second*batchSize];
+            const double* values = variables[v]+(long) start*strides[v];
+            for (int i = 0; i < count; i++)
+                row[i] = values[(long) i*strides[v]];
+        }
+        evaluateBatch(count);
+        for (int j = 0; j < numResults; j++) {
+            if (result[j] == NULL)
+                continue;
+            const double* row = &batchWorkspace[results[j]*batchSize];
+            for (int i = 0; i < count; i++)
+                result[j][start+i] = row[i];
+        }
+    }
+}
+
+void CompiledExpression::evaluateBatch(int count) const {
+    // Each operation is applied to all the values in the block, so that simple operations are vectorized by the compiler.
+
+    double* w = &batchWorkspace[0];
+    for (int step = 0; step < (int) operation.size(); step++) {
+#ifdef __PLUMED_HAS_ASMJIT
+        if (!batchJitCode.empty() && batchJitCode[step]) {
+            // A sequence of operations that has been compiled by generateBatchJitCode().
+
+            ((void (*)(double*, intptr_t)) batchJitCode[step])(w, 8*((count+3)&~3));
+            step = batchJitEnd[step]-1;
+            continue;
+        }
+#endif
+        const Operation& op = *operation[step];
+        const vector<int>& args = arguments[step];
+        double* t = w+target[step]*batchSize;
+        const double* a = w+args[0]*batchSize;
+        const double* b = (op.getNumArguments() > 1 ? w+(args.size() == 1 ? args[0]+1 : args[1])*batchSize : NULL);
+        switch (op.getId()) {
+            case Operation::CONSTANT: {
+                const double value = getConstantValue(op);
+                for (int i = 0; i < count; i++)
+                    t[i] = value;
+                break;
+            }
+            case Operation::ADD:
+                for (int i = 0; i < count; i++)
+                    t[i] = a[i]+b[i];
+                break;
+            case Operation::SUBTRACT:
+                for (int i = 0; i < count; i++)
+                    t[i] = a[i]-b[i];
+                break;
+            case Operation::MULTIPLY:
+                for (int i = 0; i < count; i++)
+                    t[i] = a[i]*b[i];
+                break;
+            case Operation::DIVIDE:
+                for (int i = 0; i < count; i++)
+                    t[i] = a[i]/b[i];
+                break;
+            case Operation::NEGATE:
+                for (int i = 0; i < count; i++)
+                    t[i] = -a[i];
+                break;
+            case Operation::SQRT:
+                for (int i = 0; i < count; i++)
+                    t[i] = std::sqrt(a[i]);
+                break;
+            case Operation::EXP:
+                for (int i = 0; i < count; i++)
+                    t[i] = std::exp(a[i]);
+                break;
+            case Operation::LOG:
+                for (int i = 0; i < count; i++)
+                    t[i] = std::log(a[i]);
+                break;
+            case Operation::SQUARE:
+                for (int i = 0; i < count; i++)
+                    t[i] = a[i]*a[i];
+                break;
+            case Operation::CUBE:
+                for (int i = 0; i < count; i++)
+                    t[i] = a[i]*a[i]*a[i];
+                break;
+            case Operation::RECIPROCAL:
+                for (int i = 0; i < count; i++)
+                    t[i] = 1.0/a[i];
+                break;
+            case Operation::ADD_CONSTANT: {
+                const double value = getConstantValue(op);
+                for (int i = 0; i < count; i++)
+                    t[i] = a[i]+value;
+                break;
+            }
+            case Operation::MULTIPLY_CONSTANT: {
+                const double value = getConstantValue(op);
+                for (int i = 0; i < count; i++)
+                    t[i] = a[i]*value;
+                break;
+            }
+            case Operation::POWER_CONSTANT: {
+                const double value = dynamic_cast<const Operation::PowerConstant&>(op).getValue();
+                int exponent = (int) value;
+                if (exponent != value) {
+                    for (int i = 0; i < count; i++)
+                        t[i] = std::pow(a[i], value);
+                    break;
+                }
+                // Same sequence of multiplications as in Operation::PowerConstant::evaluate().
+
+                batchArguments.resize(batchSize);
+                double* base = &batchArguments[0];
+                if (exponent < 0) {
+                    exponent = -exponent;
+                    for (int i = 0; i < count; i++)
+                        base[i] = 1.0/a[i];
+                }
+                else {
+                    for (int i = 0; i < count; i++)
+                        base[i] = a[i];
+                }
+                for (int i = 0; i < count; i++)
+                    t[i] = 1.0;
+                while (exponent != 0) {
+                    if ((exponent&1) == 1) {
+                        for (int i = 0; i < count; i++)
+                            t[i] *= base[i];
+                    }
+                    for (int i = 0; i < count; i++)
+                        base[i] *= base[i];
+                    exponent = exponent>>1;
+                }
+                break;
+            }
+            default: {
+                const int numArgs = op.getNumArguments();
+                for (int i = 0; i < count; i++) {
+                    for (int j = 0; j < numArgs; j++)
+                        argValues[j] = w[(args.size() == 1 ? args[0]+j : args[j])*batchSize+i];
+                    t[i] = op.evaluate(&argValues[0], dummyVariables);
+                }
+            }
+        }
+    }
 }
 
 #ifdef __PLUMED_HAS_ASMJIT
@@ -460,14 +668,220 @@ void CompiledExpression::generateJitCode() {
                 call->setRet(0, workspaceVar[target[step]]);
         }
     }
-    c.ret(workspaceVar[workspace.size()-1]);
+    // Store the values of all the expressions, so that they can be retrieved with getResult().
+
+    X86Gp resultsPointer = c.newIntPtr();
+    c.mov(resultsPointer, imm_ptr(&resultValues[0]));
+    for (int i = 0; i < (int) results.size(); i++)
+        c.movsd(x86::ptr(resultsPointer, 8*i, 0), workspaceVar[results[i]]);
+    c.ret(workspaceVar[results[0]]);
     c.endFunc();
     c.finalize();
     typedef double (*Func0)(void);
     Func0 func0;
     Error err = runtime.add(&func0,&code);
-    if(err) return;
-    jitCode = (void*) func0;
+    if(!err) jitCode = (void*) func0;
+}
+
+// Check whether an operation can be included in the code generated by generateBatchJitCode().
+static bool isBatchJitOperation(const Operation& op) {
+    switch (op.getId()) {
+        case Operation::CONSTANT:
+        case Operation::ADD:
+        case Operation::SUBTRACT:
+        case Operation::MULTIPLY:
+        case Operation::DIVIDE:
+        case Operation::NEGATE:
+        case Operation::SQRT:
+        case Operation::STEP:
+        case Operation::DELTA:
+        case Operation::SQUARE:
+        case Operation::CUBE:
+        case Operation::RECIPROCAL:
+        case Operation::ADD_CONSTANT:
+        case Operation::MULTIPLY_CONSTANT:
+            return true;
+        case Operation::POWER_CONSTANT: {
+            const double value = dynamic_cast<const Operation::PowerConstant&>(op).getValue();
+            return (int) value == value;
+        }
+        default:
+            return false;
+    }
+}
+
+void CompiledExpression::generateBatchJitCode() const {
+    batchJitCode.assign(operation.size(), NULL);
+    batchJitEnd.assign(operation.size(), 0);
+    if (!CpuInfo::getHost().hasFeature(CpuInfo::kX86FeatureAVX))
+        return;
+
+    // Make a list of all constants that will be needed for evaluation.
+
+    batchConstants.clear();
+    batchConstants.push_back(1.0);
+    batchConstants.push_back(1.0/0.0);
+    batchConstants.push_back(-0.0);
+    vector<int> operationConstantIndex(operation.size(), -1);
+    for (int step = 0; step < (int) operation.size(); step++) {
+        Operation& op = *operation[step];
+        if (op.getId() != Operation::CONSTANT && op.getId() != Operation::ADD_CONSTANT && op.getId() != Operation::MULTIPLY_CONSTANT)
+            continue;
+        operationConstantIndex[step] = batchConstants.size();
+        batchConstants.push_back(getConstantValue(op));
+    }
+
+    // Each sequence of consecutive operations that can be vectorized is compiled to a separate function.
+    // Other operations (mostly calls to mathematical functions) are evaluated by evaluateBatch(), so that
+    // the generated code never calls other functions while AVX registers are in use.
+
+    auto & runtime(*static_cast<asmjit::JitRuntime*>(runtimeptr.get()));
+    for (int first = 0; first < (int) operation.size(); ) {
+        if (!isBatchJitOperation(*operation[first])) {
+            first++;
+            continue;
+        }
+        int last = first;
+        while (last < (int) operation.size() && isBatchJitOperation(*operation[last]))
+            last++;
+        CodeHolder code;
+        code.init(runtime.getCodeInfo());
+        X86Compiler c(&code);
+        c.addFunc(FuncSignature2<void, double*, intptr_t>());
+        X86Gp block = c.newIntPtr();
+        X86Gp end = c.newIntPtr();
+        c.setArg(0, block);
+        c.setArg(1, end);
+        X86Gp constantsPointer = c.newIntPtr();
+        c.mov(constantsPointer, imm_ptr(&batchConstants[0]));
+        vector<X86Ymm> constantVar(batchConstants.size());
+        for (int i = 0; i < (int) batchConstants.size(); i++) {
+            constantVar[i] = c.newYmmPd();
+            c.vbroadcastsd(constantVar[i], x86::ptr(constantsPointer, 8*i));
+        }
+        X86Ymm zero = c.newYmmPd();
+        c.vxorpd(zero, zero, zero);
+        const X86Ymm& one = constantVar[0];
+
+        // Loop over the values in the block, four at a time.  Arguments are loaded from the workspace when
+        // they are first needed, and all results are stored back.
+
+        X86Gp offset = c.newIntPtr();
+        c.xor_(offset, offset);
+        Label loop = c.newLabel();
+        c.bind(loop);
+        vector<X86Ymm> workspaceVar(workspace.size());
+        vector<bool> loaded(workspace.size(), false);
+        for (int step = first; step < last; step++) {
+            Operation& op = *operation[step];
+            vector<int> args = arguments[step];
+            if (args.size() == 1) {
+                for (int i = 1; i < op.getNumArguments(); i++)
+                    args.push_back(args[0]+i);
+            }
+            for (int i = 0; i < op.getNumArguments(); i++)
+                if (!loaded[args[i]]) {
+                    workspaceVar[args[i]] = c.newYmmPd();
+                    c.vmovupd(workspaceVar[args[i]], x86::ptr(block, offset, 0, 8*batchSize*args[i]));
+                    loaded[args[i]] = true;
+                }
+            X86Ymm t = c.newYmmPd();
+            switch (op.getId()) {
+                case Operation::CONSTANT:
+                    c.vmovapd(t, constantVar[operationConstantIndex[step]]);
+                    break;
+                case Operation::ADD:
+                    c.vaddpd(t, workspaceVar[args[0]], workspaceVar[args[1]]);
+                    break;
+                case Operation::SUBTRACT:
+                    c.vsubpd(t, workspaceVar[args[0]], workspaceVar[args[1]]);
+                    break;
+                case Operation::MULTIPLY:
+                    c.vmulpd(t, workspaceVar[args[0]], workspaceVar[args[1]]);
+                    break;
+                case Operation::DIVIDE:
+                    c.vdivpd(t, workspaceVar[args[0]], workspaceVar[args[1]]);
+                    break;
+                case Operation::NEGATE:
+                    c.vxorpd(t, workspaceVar[args[0]], constantVar[2]);
+                    break;
+                case Operation::SQRT:
+                    c.vsqrtpd(t, workspaceVar[args[0]]);
+                    break;
+                case Operation::STEP:
+                    c.vcmppd(t, workspaceVar[args[0]], zero, imm(29)); // Comparison mode is _CMP_GE_OQ = 29
+                    c.vandpd(t, t, one);
+                    break;
+                case Operation::DELTA:
+                    c.vcmppd(t, workspaceVar[args[0]], zero, imm(0)); // Comparison mode is _CMP_EQ_OQ = 0
+                    c.vandpd(t, t, constantVar[1]);
+                    break;
+                case Operation::SQUARE:
+                    c.vmulpd(t, workspaceVar[args[0]], workspaceVar[args[0]]);
+                    break;
+                case Operation::CUBE:
+                    c.vmulpd(t, workspaceVar[args[0]], workspaceVar[args[0]]);
+                    c.vmulpd(t, t, workspaceVar[args[0]]);
+                    break;
+                case Operation::RECIPROCAL:
+                    c.vdivpd(t, one, workspaceVar[args[0]]);
+                    break;
+                case Operation::ADD_CONSTANT:
+                    c.vaddpd(t, workspaceVar[args[0]], constantVar[operationConstantIndex[step]]);
+                    break;
+                case Operation::MULTIPLY_CONSTANT:
+                    c.vmulpd(t, workspaceVar[args[0]], constantVar[operationConstantIndex[step]]);
+                    break;
+                case Operation::POWER_CONSTANT: {
+                    // Same sequence of multiplications as in Operation::PowerConstant::evaluate().
+
+                    int exponent = (int) dynamic_cast<Operation::PowerConstant&>(op).getValue();
+                    X86Ymm base = c.newYmmPd();
+                    if (exponent < 0) {
+                        exponent = -exponent;
+                        c.vdivpd(base, one, workspaceVar[args[0]]);
+                    }
+                    else
+                        c.vmovapd(base, workspaceVar[args[0]]);
+                    if (exponent == 0)
+                        c.vmovapd(t, one);
+                    bool started = false;
+                    while (exponent != 0) {
+                        if ((exponent&1) == 1) {
+                            if (started)
+                                c.vmulpd(t, t, base);
+                            else
+                                c.vmovapd(t, base);
+                            started = true;
+                        }
+                        exponent = exponent>>1;
+                        if (exponent != 0)
+                            c.vmulpd(base, base, base);
+                    }
+                    break;
+                }
+                default:
+                    break;
+            }
+            workspaceVar[target[step]] = t;
+            loaded[target[step]] = true;
+            c.vmovupd(x86::ptr(block, offset, 0, 8*batchSize*target[step]), t);
+        }
+        c.add(offset, 32);
+        c.cmp(offset, end);
+        c.jb(loop);
+        c.vzeroupper();
+        c.endFunc();
+        c.finalize();
+        typedef void (*BatchFunc)(double*, intptr_t);
+        BatchFunc func;
+        Error err = runtime.add(&func,&code);
+        if (!err) {
+            batchJitCode[first] = (void*) func;
+            batchJitEnd[first] = last;
+        }
+        first = last;
+    }
 }
 
 void generateSingleArgCall(X86Compiler& c, X86Xmm& dest, X86Xmm& arg, double (*function)(double)) {
@@ -115,6 +115,12 @@ class ParsedExpression;
 class LEPTON_EXPORT CompiledExpression {
 public:
     CompiledExpression();
+    /**
+     * Create a CompiledExpression that evaluates several expressions at once, typically an expression and its
+     * derivatives.  Subexpressions that appear in more than one of them are only evaluated once.  evaluate()
+     * returns the value of the first expression, and the values of all of them can be retrieved with getResult().
+     */
+    explicit CompiledExpression(const std::vector<ParsedExpression>& expressions);
     CompiledExpression(const CompiledExpression& expression);
     ~CompiledExpression();
     CompiledExpression& operator=(const CompiledExpression& expression);
@@ -137,6 +143,27 @@ public:
      * Evaluate the expression.  The values of all variables should have been set before calling this.
      */
     double evaluate() const;
+    /**
+     * Get the value of the index-th expression computed by the last call to evaluate().  Index 0 corresponds
+     * to the value returned by evaluate().
+     */
+    double getResult(int index) const;
+    /**
+     * Evaluate the expression for n different sets of values of the variables.  variables[i] points to the
+     * values of the i-th variable, in the order returned by getVariables(), and consecutive values are separated
+     * by strides[i] elements.  A stride of 0 can be used for a variable that has the same value for all the sets.
+     * The n results are stored in result.  Memory locations set with setVariableLocations() are not used.
+     *
+     * Sets of values are processed in blocks, one operation at a time, which is much faster than calling
+     * evaluate() n times.  When asmjit is enabled and the CPU supports AVX, sequences of arithmetic operations
+     * are evaluated by JIT-compiled code working on four values at a time.
+     */
+    void evaluate(int n, const std::vector<const double*>& variables, const std::vector<int>& strides, double* result) const;
+    /**
+     * Evaluate n sets of values as above, storing the values of the i-th expression in result[i].  Fewer pointers
+     * than expressions can be passed, and null pointers are skipped.
+     */
+    void evaluate(int n, const std::vector<const double*>& variables, const std::vector<int>& strides, const std::vector<double*>& result) const;
 private:
     friend class ParsedExpression;
     CompiledExpression(const ParsedExpression& expression);
@@ -149,13 +176,30 @@ private:
     std::vector<Operation*> operation;
     std::map<std::string, int> variableIndices;
     std::set<std::string> variableNames;
+    // Indices in workspace of the values of the expressions.
+    std::vector<int> results;
+    mutable std::vector<double> resultValues;
     mutable std::vector<double> workspace;
     mutable std::vector<double> argValues;
     std::map<std::string, double> dummyVariables;
     void* jitCode;
     void generateJitCode();
     std::vector<double> constants;
-    AsmJitRuntimePtr runtimeptr;
+    // Number of sets of values evaluated together by evaluate(n,variables,strides,result).
+    static const int batchSize = 64;
+    // Workspace used by evaluate(n,variables,strides,result), with batchSize values for each element of workspace.
+    mutable std::vector<double> batchWorkspace;
+    void evaluateBlocks(int n, const std::vector<const double*>& variables, const std::vector<int>& strides, double* const* result, int numResults) const;
+    void evaluateBatch(int count) const;
+    // Functions generated by generateBatchJitCode(), evaluating the operations from a step up to batchJitEnd[step].
+    // They are generated by the first call to evaluate(n,variables,strides,result).
+    mutable std::vector<void*> batchJitCode;
+    mutable std::vector<int> batchJitEnd;
+    mutable bool batchJitGenerated;
+    void generateBatchJitCode() const;
+    mutable std::vector<double> batchConstants;
+    mutable std::vector<double> batchArguments;
+    mutable AsmJitRuntimePtr runtimeptr;
 };
 
 } // namespace lepton
@@ -165,53 +165,62 @@ void BiasRepresentation::pushKernel( IFile *ifile ) {
     if(doInt_&&(kk->getCenter()[0]+kk->getContinuousSupport()[0] > uppI_ || kk->getCenter()[0]-kk->getContinuousSupport()[0] < lowI_ )) {
       nneighb=BiasGrid_->getNbin();
     } else nneighb=kk->getSupport(BiasGrid_->getDx());
-    vector<Grid::index_t> neighbors=BiasGrid_->getNeighbors(kk->getCenter(),nneighb);
-    vector<double> der(ndim);
-    vector<double> xx(ndim);
-    if(mycomm.Get_size()==1) {
-      for(unsigned i=0; i<neighbors.size(); ++i) {
-        Grid::index_t ineigh=neighbors[i];
-        for(int j=0; j<ndim; ++j) {der[j]=0.0;}
-        BiasGrid_->getPoint(ineigh,xx);
-        // assign xx to a new vector of values
-        for(int j=0; j<ndim; ++j) {values[j]->set(xx[j]);}
-        double bias;
-        if(doInt_) bias=kk->evaluate(values,der,true,doInt_,lowI_,uppI_);
-        else bias=kk->evaluate(values,der,true);
-        if(rescaledToBias) {
-          double f=(biasf.back()-1.)/(biasf.back());
-          bias*=f;
-          for(int j=0; j<ndim; ++j) {der[j]*=f;}
-        }
-        BiasGrid_->addValueAndDerivatives(ineigh,bias,der);
-      }
+    if(!doInt_ && kk->isSeparableGaussian()) {
+      // diagonal Gaussians are deposited as an outer product of one-dimensional tables
+      double height=kk->getHeight();
+      if(rescaledToBias) height*=(biasf.back()-1.)/(biasf.back());
+      vector<double> invwidth(kk->getWidth());
+      for(int j=0; j<ndim; ++j) invwidth[j]=1.0/invwidth[j];
+      BiasGrid_->addSeparableGaussian(kk->getCenter(),invwidth,height,nneighb);
     } else {
-      unsigned stride=mycomm.Get_size();
-      unsigned rank=mycomm.Get_rank();
-      vector<double> allder(ndim*neighbors.size(),0.0);
-      vector<double> allbias(neighbors.size(),0.0);
-      vector<double> tmpder(ndim);
-      for(unsigned i=rank; i<neighbors.size(); i+=stride) {
-        Grid::index_t ineigh=neighbors[i];
-        BiasGrid_->getPoint(ineigh,xx);
-        for(int j=0; j<ndim; ++j) {values[j]->set(xx[j]);}
-        if(doInt_) allbias[i]=kk->evaluate(values,der,true,doInt_,lowI_,uppI_);
-        else allbias[i]=kk->evaluate(values,der,true);
-        if(rescaledToBias) {
-          double f=(biasf.back()-1.)/(biasf.back());
-          allbias[i]*=f;
-          for(int j=0; j<ndim; ++j) {tmpder[j]*=f;}
+      vector<Grid::index_t> neighbors=BiasGrid_->getNeighbors(kk->getCenter(),nneighb);
+      vector<double> der(ndim);
+      vector<double> xx(ndim);
+      if(mycomm.Get_size()==1) {
+        for(unsigned i=0; i<neighbors.size(); ++i) {
+          Grid::index_t ineigh=neighbors[i];
+          for(int j=0; j<ndim; ++j) {der[j]=0.0;}
+          BiasGrid_->getPoint(ineigh,xx);
+          // assign xx to a new vector of values
+          for(int j=0; j<ndim; ++j) {values[j]->set(xx[j]);}
+          double bias;
+          if(doInt_) bias=kk->evaluate(values,der,true,doInt_,lowI_,uppI_);
+          else bias=kk->evaluate(values,der,true);
+          if(rescaledToBias) {
+            double f=(biasf.back()-1.)/(biasf.back());
+            bias*=f;
+            for(int j=0; j<ndim; ++j) {der[j]*=f;}
+          }
+          BiasGrid_->addValueAndDerivatives(ineigh,bias,der);
+        }
+      } else {
+        unsigned stride=mycomm.Get_size();
+        unsigned rank=mycomm.Get_rank();
+        vector<double> allder(ndim*neighbors.size(),0.0);
+        vector<double> allbias(neighbors.size(),0.0);
+        vector<double> tmpder(ndim);
+        for(unsigned i=rank; i<neighbors.size(); i+=stride) {
+          Grid::index_t ineigh=neighbors[i];
+          BiasGrid_->getPoint(ineigh,xx);
+          for(int j=0; j<ndim; ++j) {values[j]->set(xx[j]);}
+          if(doInt_) allbias[i]=kk->evaluate(values,der,true,doInt_,lowI_,uppI_);
+          else allbias[i]=kk->evaluate(values,der,true);
+          if(rescaledToBias) {
+            double f=(biasf.back()-1.)/(biasf.back());
+            allbias[i]*=f;
+            for(int j=0; j<ndim; ++j) {tmpder[j]*=f;}
+          }
+          // this solution with the temporary vector is rather bad, probably better to take
+          // a pointer of double as it was in old gaussian
+          for(int j=0; j<ndim; ++j) { allder[ndim*i+j]=tmpder[j]; tmpder[j]=0.;}
+        }
+        mycomm.Sum(allbias);
+        mycomm.Sum(allder);
+        for(unsigned i=0; i<neighbors.size(); ++i) {
+          Grid::index_t ineigh=neighbors[i];
+          for(int j=0; j<ndim; ++j) {der[j]=allder[ndim*i+j];}
+          BiasGrid_->addValueAndDerivatives(ineigh,allbias[i],der);
         }
-        // this solution with the temporary vector is rather bad, probably better to take
-        // a pointer of double as it was in old gaussian
-        for(int j=0; j<ndim; ++j) { allder[ndim*i+j]=tmpder[j]; tmpder[j]=0.;}
-      }
-      mycomm.Sum(allbias);
-      mycomm.Sum(allder);
-      for(unsigned i=0; i<neighbors.size(); ++i) {
-        Grid::index_t ineigh=neighbors[i];
-        for(int j=0; j<ndim; ++j) {der[j]=allder[ndim*i+j];}
-        BiasGrid_->addValueAndDerivatives(ineigh,allbias[i],der);
       }
     }
   }
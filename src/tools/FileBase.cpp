@@ -39,7 +39,12 @@
 
 namespace PLMD {
 
+const char FileBase::binaryMagic[8]="PLMDBIN";
+const unsigned char FileBase::binaryVersion;
+const std::uint32_t FileBase::binaryEndianTag;
+
 FileBase& FileBase::link(FILE*fp) {
+  waitAsync();
   plumed_massert(!this->fp,"cannot link an already open file");
   this->fp=fp;
   cloned=true;
@@ -52,12 +57,14 @@ FileBase& FileBase::flush() {
 }
 
 FileBase& FileBase::link(Communicator&comm) {
+  waitAsync();
   plumed_massert(!fp,"cannot link an already open file");
   this->comm=&comm;
   return *this;
 }
 
 FileBase& FileBase::link(PlumedMain&plumed) {
+  waitAsync();
   plumed_massert(!fp,"cannot link an already open file");
   this->plumed=&plumed;
   link(plumed.comm);
@@ -65,6 +72,7 @@ FileBase& FileBase::link(PlumedMain&plumed) {
 }
 
 FileBase& FileBase::link(Action&action) {
+  waitAsync();
   plumed_massert(!fp,"cannot link an already open file");
   this->action=&action;
   link(action.plumed);
@@ -87,6 +95,7 @@ bool FileBase::FileExist(const std::string& path) {
 }
 
 bool FileBase::isOpen() {
+  waitAsync();
   bool isopen=false;
   if(fp) isopen=true;
   return isopen;
@@ -23,6 +23,7 @@
 #define __PLUMED_tools_FileBase_h
 
 #include <string>
+#include <cstdint>
 
 namespace PLMD {
 
@@ -79,6 +80,22 @@ protected:
   std::string mode;
 /// Set to true if you want flush to be heavy (close/reopen)
   bool heavyFlush;
+/// Wait until fp is not used by other threads anymore.
+/// It should be called before accessing fp, with the exception of the methods
+/// used to write data. Overridden by OFile, which can write data in a background thread.
+  virtual void waitAsync()const {}
+/// Magic string (without terminator) starting each header of a binary fielded file.
+/// A binary fielded file is a sequence of blocks, all written in the native endianness:
+/// - a header, made of the magic string, one byte with binaryVersion, a 32-bit binaryEndianTag,
+///   a 32-bit number of fields followed by their names, a 32-bit number of constant
+///   fields followed by their names and values. Strings are stored as a 32-bit length
+///   followed by the characters. A new header is written whenever fields change.
+/// - a record, made of a zero byte followed by one double for each field.
+  static const char binaryMagic[8];
+/// Version of the binary fielded format
+  static const unsigned char binaryVersion=1;
+/// Used to detect the endianness of binary fielded files
+  static const std::uint32_t binaryEndianTag=0x01020304;
 public:
 /// Append suffix.
 /// It appends the desired suffix to the string. Notice that
@@ -107,7 +124,7 @@ public:
   virtual FileBase& flush();
 /// Closes the file
 /// Should be used only for explicitely opened files.
-  void        close();
+  virtual void close();
 /// Virtual destructor (allows inheritance)
   virtual ~FileBase();
 /// Check for error/eof.
@@ -144,6 +161,7 @@ std::string FileBase::getMode()const {
 
 inline
 FILE* FileBase::getFILE()const {
+  waitAsync();
   return fp;
 }
 
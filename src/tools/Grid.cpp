@@ -28,6 +28,7 @@
 #include "KernelFunctions.h"
 #include "RootFindingBase.h"
 #include "Communicator.h"
+#include "OpenMP.h"
 
 #include <vector>
 #include <cmath>
@@ -36,6 +37,8 @@
 #include <cstdio>
 #include <cfloat>
 #include <array>
+#include <algorithm>
+#include <cstdint>
 
 using namespace std;
 namespace PLMD {
@@ -359,38 +362,132 @@ vector<GridBase::index_t> GridBase::getNearestNeighbors(const vector<unsigned> &
 }
 
 
+void GridBase::addSeparableGaussian( const std::vector<double>& center, const std::vector<double>& invsigma, double height,
+                                     const std::vector<unsigned>& nneigh, double cutoff ) {
+  plumed_dbg_assert( center.size()==dimension_ && invsigma.size()==dimension_ && nneigh.size()==dimension_ );
+  const std::vector<unsigned> indices( getIndices( center ) );
+
+// one-dimensional tables, with one entry for each grid line crossed by the Gaussian.
+// the same periodic wrapping used in getNeighbors is applied here
+  std::vector<std::vector<index_t>> tindex( dimension_ );
+  std::vector<std::vector<double>> tdp2( dimension_ ), texp( dimension_ ), tder( dimension_ );
+  index_t stride=1;
+  for(unsigned i=0; i<dimension_; ++i) {
+    const double period=max_[i]-min_[i];
+    const double invperiod=1.0/period;
+    for(unsigned k=0; k<2*nneigh[i]+1; ++k) {
+      int i0=static_cast<int>(k)-static_cast<int>(nneigh[i])+static_cast<int>(indices[i]);
+      if(!pbc_[i] && i0<0)         continue;
+      if(!pbc_[i] && i0>=static_cast<int>(nbin_[i])) continue;
+      if( pbc_[i] && i0<0)         i0=nbin_[i]-(-i0)%nbin_[i];
+      if( pbc_[i] && i0>=static_cast<int>(nbin_[i])) i0%=nbin_[i];
+      double diff=min_[i]+static_cast<double>(i0)*dx_[i]-center[i];
+      if(pbc_[i]) diff=Tools::pbc(diff*invperiod)*period;
+      const double dp=diff*invsigma[i];
+      tindex[i].push_back( static_cast<index_t>(i0)*stride );
+      tdp2[i].push_back( dp*dp );
+      texp[i].push_back( std::exp(-0.5*dp*dp) );
+      tder[i].push_back( -dp*invsigma[i] );
+    }
+    if(tindex[i].empty()) return;
+    stride*=nbin_[i];
+  }
+
+// the first dimension is the fastest in the grid storage, so it is used in the inner loop.
+// the other dimensions are traversed as an odometer
+  std::vector<unsigned> k( dimension_, 0 );
+  std::vector<double> der( dimension_ );
+  const unsigned n0=tindex[0].size();
+  while(true) {
+    index_t base=0;
+    double dp2=0.0;
+    double fact=height;
+    for(unsigned i=1; i<dimension_; ++i) {
+      base+=tindex[i][k[i]];
+      dp2+=tdp2[i][k[i]];
+      fact*=texp[i][k[i]];
+    }
+    if(0.5*dp2<cutoff) {
+      for(unsigned j=0; j<n0; ++j) {
+        if(0.5*(dp2+tdp2[0][j])>=cutoff) continue;
+        const double val=fact*texp[0][j];
+        if( usederiv_ ) {
+          der[0]=val*tder[0][j];
+          for(unsigned i=1; i<dimension_; ++i) der[i]=val*tder[i][k[i]];
+          addValueAndDerivatives( base+tindex[0][j], val, der );
+        } else {
+          addValue( base+tindex[0][j], val );
+        }
+      }
+    }
+    unsigned i=1;
+    for(; i<dimension_; ++i) {
+      if(++k[i]<tindex[i].size()) break;
+      k[i]=0;
+    }
+    if(i>=dimension_) break;
+  }
+}
+
 void GridBase::addKernel( const KernelFunctions& kernel ) {
   plumed_dbg_assert( kernel.ndim()==dimension_ );
   std::vector<unsigned> nneighb=kernel.getSupport( dx_ );
+  if( kernel.isSeparableGaussian() ) {
+    std::vector<double> invwidth( kernel.getWidth() );
+    for(unsigned i=0; i<dimension_; ++i) invwidth[i]=1.0/invwidth[i];
+    addSeparableGaussian( kernel.getCenter(), invwidth, kernel.getHeight(), nneighb );
+    return;
+  }
   std::vector<index_t> neighbors=getNeighbors( kernel.getCenter(), nneighb );
-  std::vector<double> xx( dimension_ );
-  std::vector<std::unique_ptr<Value>> vv( dimension_ );
-  std::string str_min, str_max;
+  std::vector<std::string> str_min( dimension_ ), str_max( dimension_ );
   for(unsigned i=0; i<dimension_; ++i) {
-    vv[i].reset(new Value());
     if( pbc_[i] ) {
-      Tools::convert(min_[i],str_min);
-      Tools::convert(max_[i],str_max);
-      vv[i]->setDomain( str_min, str_max );
-    } else {
-      vv[i]->setNotPeriodic();
+      Tools::convert(min_[i],str_min[i]);
+      Tools::convert(max_[i],str_max[i]);
     }
   }
 
+// the kernel is evaluated in parallel on all the neighbors, and the results
+// are then added serially. In this way the result does not depend on the number
+// of threads and grids without a thread-safe storage (e.g. SparseGrid) can be used
+  const index_t nneigh=neighbors.size();
+  std::vector<double> newval( nneigh );
+  std::vector<double> newder( usederiv_ ? nneigh*dimension_ : 0 );
+  unsigned nt=OpenMP::getNumThreads();
+  if(nt*64>nneigh) nt=1;
+
+  #pragma omp parallel num_threads(nt)
+  {
+    std::vector<double> xx( dimension_ );
+    std::vector<std::unique_ptr<Value>> vv( dimension_ );
+    for(unsigned i=0; i<dimension_; ++i) {
+      vv[i].reset(new Value());
+      if( pbc_[i] ) vv[i]->setDomain( str_min[i], str_max[i] );
+      else vv[i]->setNotPeriodic();
+    }
+
 // vv_ptr contains plain pointers obtained from vv.
 // this is the simplest way to replace a unique_ptr here.
 // perhaps the interface of kernel.evaluate() should be changed
 // in order to accept a std::vector<std::unique_ptr<Value>>
-  auto vv_ptr=Tools::unique2raw(vv);
+    auto vv_ptr=Tools::unique2raw(vv);
+
+    std::vector<double> der( dimension_ );
+    #pragma omp for
+    for(index_t i=0; i<nneigh; ++i) {
+      getPoint( neighbors[i], xx );
+      for(unsigned j=0; j<dimension_; ++j) vv[j]->set(xx[j]);
+      newval[i] = kernel.evaluate( vv_ptr, der, usederiv_ );
+      if( usederiv_ ) for(unsigned j=0; j<dimension_; ++j) newder[i*dimension_+j]=der[j];
+    }
+  }
 
   std::vector<double> der( dimension_ );
-  for(unsigned i=0; i<neighbors.size(); ++i) {
-    index_t ineigh=neighbors[i];
-    getPoint( ineigh, xx );
-    for(unsigned j=0; j<dimension_; ++j) vv[j]->set(xx[j]);
-    double newval = kernel.evaluate( vv_ptr, der, usederiv_ );
-    if( usederiv_ ) addValueAndDerivatives( ineigh, newval, der );
-    else addValue( ineigh, newval );
+  for(index_t i=0; i<nneigh; ++i) {
+    if( usederiv_ ) {
+      for(unsigned j=0; j<dimension_; ++j) der[j]=newder[i*dimension_+j];
+      addValueAndDerivatives( neighbors[i], newval[i], der );
+    } else addValue( neighbors[i], newval[i] );
   }
 }
 
@@ -640,13 +737,17 @@ double Grid::getMaxValue() const {
 }
 
 void Grid::scaleAllValuesAndDerivatives( const double& scalef ) {
+  const index_t n=grid_.size();
+  unsigned nt=OpenMP::getGoodNumThreads(grid_);
   if(usederiv_) {
-    for(index_t i=0; i<grid_.size(); ++i) {
+    #pragma omp parallel for num_threads(nt)
+    for(index_t i=0; i<n; ++i) {
       grid_[i]*=scalef;
       for(unsigned j=0; j<dimension_; ++j) der_[i*dimension_+j]*=scalef;
     }
   } else {
-    for(index_t i=0; i<grid_.size(); ++i) grid_[i]*=scalef;
+    #pragma omp parallel for num_threads(nt)
+    for(index_t i=0; i<n; ++i) grid_[i]*=scalef;
   }
 }
 
@@ -668,13 +769,17 @@ void Grid::setMinToZero() {
 }
 
 void Grid::applyFunctionAllValuesAndDerivatives( double (*func)(double val), double (*funcder)(double valder) ) {
+  const index_t n=grid_.size();
+  unsigned nt=OpenMP::getGoodNumThreads(grid_);
   if(usederiv_) {
-    for(index_t i=0; i<grid_.size(); ++i) {
+    #pragma omp parallel for num_threads(nt)
+    for(index_t i=0; i<n; ++i) {
       grid_[i]=func(grid_[i]);
       for(unsigned j=0; j<dimension_; ++j) der_[i*dimension_+j]=funcder(der_[i*dimension_+j]);
     }
   } else {
-    for(index_t i=0; i<grid_.size(); ++i) grid_[i]=func(grid_[i]);
+    #pragma omp parallel for num_threads(nt)
+    for(index_t i=0; i<n; ++i) grid_[i]=func(grid_[i]);
   }
 }
 
@@ -768,8 +873,115 @@ void Grid::addValueAndDerivatives
   for(unsigned int i=0; i<dimension_; ++i) der_[index*dimension_+i]+=der[i];
 }
 
+constexpr SparseGrid::index_t SparseGrid::emptykey;
+
+SparseGrid::SparseGrid(const std::string& funcl, const std::vector<Value*> & args, const std::vector<std::string> & gmin,
+                       const std::vector<std::string> & gmax,
+                       const std::vector<unsigned> & nbin, bool dospline, bool usederiv):
+  GridBase(funcl,args,gmin,gmax,nbin,dospline,usederiv),
+  tilebin_(dimension_),
+  tilesize_(1),
+  tilestencil_(dimension_),
+  offsetstencil_(dimension_),
+  hashbits_(6),
+  ntiles_(0)
+{
+// tiles contain about 1024 points, so that a tile with derivatives
+// fits in the L1/L2 cache also in 5D
+  const unsigned target=1024;
+  unsigned side=1;
+  while(true) {
+    unsigned n=1;
+    for(unsigned i=0; i<dimension_; ++i) n*=(side+1);
+    if(n>target) break;
+    side++;
+  }
+  index_t ntilestride=1;
+  unsigned tilestride=1;
+  for(unsigned i=0; i<dimension_; ++i) {
+    tilebin_[i]=std::min(side,nbin_[i]);
+    const unsigned ntile=(nbin_[i]+tilebin_[i]-1)/tilebin_[i];
+    tilestencil_[i].resize(nbin_[i]);
+    offsetstencil_[i].resize(nbin_[i]);
+    for(unsigned j=0; j<nbin_[i]; ++j) {
+      tilestencil_[i][j]=(j/tilebin_[i])*ntilestride;
+      offsetstencil_[i][j]=(j%tilebin_[i])*tilestride;
+    }
+    ntilestride*=ntile;
+    tilestride*=tilebin_[i];
+  }
+  tilesize_=tilestride;
+  hashkeys_.assign(index_t(1)<<hashbits_,emptykey);
+  hashslots_.assign(index_t(1)<<hashbits_,0);
+}
+
+void SparseGrid::locate(index_t index, index_t& tile, unsigned& offset) const {
+  plumed_dbg_assert(index<maxsize_);
+  tile=0; offset=0;
+  for(unsigned i=0; i<dimension_; ++i) {
+    const unsigned j=index%nbin_[i];
+    index/=nbin_[i];
+    tile+=tilestencil_[i][j];
+    offset+=offsetstencil_[i][j];
+  }
+}
+
+unsigned SparseGrid::hashPosition(index_t tile) const {
+  const index_t mask=hashkeys_.size()-1;
+// Fibonacci hashing followed by linear probing
+  index_t pos=(static_cast<std::uint64_t>(tile)*UINT64_C(0x9E3779B97F4A7C15))>>(64-hashbits_);
+  while(hashkeys_[pos]!=emptykey && hashkeys_[pos]!=tile) pos=(pos+1)&mask;
+  return pos;
+}
+
+long SparseGrid::findPoint(index_t index) const {
+  index_t tile; unsigned offset;
+  locate(index,tile,offset);
+  const unsigned pos=hashPosition(tile);
+  if(hashkeys_[pos]==emptykey) return -1;
+  return static_cast<long>(hashslots_[pos])*tilesize_+offset;
+}
+
+Grid::index_t SparseGrid::allocatePoint(index_t index) {
+  index_t tile; unsigned offset;
+  locate(index,tile,offset);
+  unsigned pos=hashPosition(tile);
+  if(hashkeys_[pos]==emptykey) {
+// keep the load factor below 1/2
+    if(2*(ntiles_+1)>hashkeys_.size()) {
+      rehash();
+      pos=hashPosition(tile);
+    }
+    hashkeys_[pos]=tile;
+    hashslots_[pos]=ntiles_;
+    ntiles_++;
+    values_.resize(static_cast<size_t>(ntiles_)*tilesize_,0.0);
+    visited_.resize(static_cast<size_t>(ntiles_)*tilesize_,0);
+    if(usederiv_) derivs_.resize(static_cast<size_t>(ntiles_)*tilesize_*dimension_,0.0);
+  }
+  const index_t point=static_cast<index_t>(hashslots_[pos])*tilesize_+offset;
+  if(!visited_[point]) {
+    visited_[point]=1;
+    visitedlist_.push_back(index);
+  }
+  return point;
+}
+
+void SparseGrid::rehash() {
+  hashbits_++;
+  std::vector<index_t> oldkeys(index_t(1)<<hashbits_,emptykey);
+  std::vector<unsigned> oldslots(index_t(1)<<hashbits_,0);
+  std::swap(oldkeys,hashkeys_);
+  std::swap(oldslots,hashslots_);
+  for(unsigned i=0; i<oldkeys.size(); ++i) if(oldkeys[i]!=emptykey) {
+      const unsigned pos=hashPosition(oldkeys[i]);
+      hashkeys_[pos]=oldkeys[i];
+      hashslots_[pos]=oldslots[i];
+    }
+}
+
 Grid::index_t SparseGrid::getSize() const {
-  return map_.size();
+  return visitedlist_.size();
 }
 
 Grid::index_t SparseGrid::getMaxSize() const {
@@ -778,47 +990,47 @@ Grid::index_t SparseGrid::getMaxSize() const {
 
 double SparseGrid::getValue(index_t index)const {
   plumed_assert(index<maxsize_);
-  double value=0.0;
-  const auto it=map_.find(index);
-  if(it!=map_.end()) value=it->second;
-  return value;
+  const long point=findPoint(index);
+  if(point<0) return 0.0;
+  return values_[point];
 }
 
 double SparseGrid::getValueAndDerivatives
 (index_t index, vector<double>& der)const {
   plumed_assert(index<maxsize_ && usederiv_ && der.size()==dimension_);
-  double value=0.0;
-  for(unsigned int i=0; i<dimension_; ++i) der[i]=0.0;
-  const auto it=map_.find(index);
-  if(it!=map_.end()) value=it->second;
-  const auto itder=der_.find(index);
-  if(itder!=der_.end()) der=itder->second;
-  return value;
+  const long point=findPoint(index);
+  if(point<0) {
+    for(unsigned int i=0; i<dimension_; ++i) der[i]=0.0;
+    return 0.0;
+  }
+  for(unsigned int i=0; i<dimension_; ++i) der[i]=derivs_[point*dimension_+i];
+  return values_[point];
 }
 
 void SparseGrid::setValue(index_t index, double value) {
   plumed_assert(index<maxsize_ && !usederiv_);
-  map_[index]=value;
+  values_[allocatePoint(index)]=value;
 }
 
 void SparseGrid::setValueAndDerivatives
 (index_t index, double value, vector<double>& der) {
   plumed_assert(index<maxsize_ && usederiv_ && der.size()==dimension_);
-  map_[index]=value;
-  der_[index]=der;
+  const index_t point=allocatePoint(index);
+  values_[point]=value;
+  for(unsigned int i=0; i<dimension_; ++i) derivs_[point*dimension_+i]=der[i];
 }
 
 void SparseGrid::addValue(index_t index, double value) {
   plumed_assert(index<maxsize_ && !usederiv_);
-  map_[index]+=value;
+  values_[allocatePoint(index)]+=value;
 }
 
 void SparseGrid::addValueAndDerivatives
 (index_t index, double value, vector<double>& der) {
   plumed_assert(index<maxsize_ && usederiv_ && der.size()==dimension_);
-  map_[index]+=value;
-  der_[index].resize(dimension_);
-  for(unsigned int i=0; i<dimension_; ++i) der_[index][i]+=der[i];
+  const index_t point=allocatePoint(index);
+  values_[point]+=value;
+  for(unsigned int i=0; i<dimension_; ++i) derivs_[point*dimension_+i]+=der[i];
 }
 
 void SparseGrid::writeToFile(OFile& ofile) {
@@ -827,8 +1039,10 @@ void SparseGrid::writeToFile(OFile& ofile) {
   double f;
   writeHeader(ofile);
   ofile.fmtField(" "+fmt_);
-  for(const auto & it : map_) {
-    index_t i=it.first;
+// points are written in the order of the dense grid
+  std::vector<index_t> sorted(visitedlist_);
+  std::sort(sorted.begin(),sorted.end());
+  for(const auto i : sorted) {
     xx=getPoint(i);
     if(usederiv_) {f=getValueAndDerivatives(i,der);}
     else {f=getValue(i);}
@@ -847,11 +1061,12 @@ void SparseGrid::writeToFile(OFile& ofile) {
   }
 }
 
+// points that were not visited are zero, so that they can be included here
 double SparseGrid::getMinValue() const {
   double minval;
   minval=0.0;
-  for(auto const & i : map_) {
-    if(i.second<minval) minval=i.second;
+  for(const auto v : values_) {
+    if(v<minval) minval=v;
   }
   return minval;
 }
@@ -859,8 +1074,8 @@ double SparseGrid::getMinValue() const {
 double SparseGrid::getMaxValue() const {
   double maxval;
   maxval=0.0;
-  for(auto const & i : map_) {
-    if(i.second>maxval) maxval=i.second;
+  for(const auto v : values_) {
+    if(v>maxval) maxval=v;
   }
   return maxval;
 }
@@ -950,7 +1165,12 @@ Grid Grid::project(const std::vector<std::string> & proj, WeightBase *ptr2obj )
   //}
 
   // loop over all the points in the Grid, find the corresponding fixed index, rotate over all the other ones
-  for(unsigned i=0; i<smallgrid.getSize(); i++) {
+  // each point of the small grid is computed independently, so that the result does not depend on the number of threads
+  const unsigned nsmall=smallgrid.getSize();
+  unsigned nt=OpenMP::getNumThreads();
+  if(nt>nsmall) nt=1;
+  #pragma omp parallel for num_threads(nt) schedule(dynamic)
+  for(unsigned i=0; i<nsmall; i++) {
     std::vector<unsigned> v;
     v=smallgrid.getIndices(i);
     std::vector<int> vHigh((getArgNames()).size(),-1);
@@ -962,7 +1182,8 @@ Grid Grid::project(const std::vector<std::string> & proj, WeightBase *ptr2obj )
   }
   // reset to zero just for biasing (this option can be evtl enabled in a future...)
   //double vmin;vmin=-smallgrid.getMinValue()+1;
-  for(unsigned i=0; i<smallgrid.getSize(); i++) {
+  #pragma omp parallel for num_threads(nt)
+  for(unsigned i=0; i<nsmall; i++) {
     //         //if(dynamic_cast<BiasWeight*>(ptr2obj)){
     //         //        smallgrid.addValue(i,vmin);// go to 1
     //         //}
@@ -991,19 +1212,38 @@ double Grid::integrate( std::vector<unsigned>& npoints ) {
     ntotgrid*=npoints[j]; box_vol*=ispacing[j];
   }
 
-  std::vector<double> vals( dimension_ );
-  std::vector<unsigned> t_index( dimension_ ); double integral=0.0;
-  for(unsigned i=0; i<ntotgrid; ++i) {
-    t_index[0]=(i%npoints[0]);
-    unsigned kk=i;
-    for(unsigned j=1; j<dimension_-1; ++j) { kk=(kk-t_index[j-1])/npoints[j-1]; t_index[j]=(kk%npoints[j]); }
-    if( dimension_>=2 ) t_index[dimension_-1]=((kk-t_index[dimension_-2])/npoints[dimension_-2]);
-
-    for(unsigned j=0; j<dimension_; ++j) vals[j]=min_[j] + t_index[j]*ispacing[j];
-
-    integral += getValue( vals );
+// points are summed in blocks of fixed size, and the partial sums are then added in order.
+// In this way the result does not depend on the number of threads
+  const unsigned blocksize=1024;
+  const unsigned nblocks=(ntotgrid+blocksize-1)/blocksize;
+  std::vector<double> partial( nblocks, 0.0 );
+  unsigned nt=OpenMP::getNumThreads();
+  if(nt>nblocks) nt=1;
+
+  #pragma omp parallel num_threads(nt)
+  {
+    std::vector<double> vals( dimension_ );
+    std::vector<unsigned> t_index( dimension_ );
+    #pragma omp for
+    for(unsigned b=0; b<nblocks; ++b) {
+      const unsigned end=std::min( ntotgrid, (b+1)*blocksize );
+      double sum=0.0;
+      for(unsigned i=b*blocksize; i<end; ++i) {
+        t_index[0]=(i%npoints[0]);
+        unsigned kk=i;
+        for(unsigned j=1; j<dimension_-1; ++j) { kk=(kk-t_index[j-1])/npoints[j-1]; t_index[j]=(kk%npoints[j]); }
+        if( dimension_>=2 ) t_index[dimension_-1]=((kk-t_index[dimension_-2])/npoints[dimension_-2]);
+
+        for(unsigned j=0; j<dimension_; ++j) vals[j]=min_[j] + t_index[j]*ispacing[j];
+
+        sum += getValue( vals );
+      }
+      partial[b]=sum;
+    }
   }
 
+  double integral=0.0;
+  for(unsigned b=0; b<nblocks; ++b) integral+=partial[b];
   return box_vol*integral;
 }
 
@@ -27,6 +27,7 @@
 #include <map>
 #include <cmath>
 #include <memory>
+#include <limits>
 
 namespace PLMD {
 
@@ -187,6 +188,13 @@ public:
   void addValueAndDerivatives(const std::vector<unsigned> & indices, double value, std::vector<double>& der);
 /// add a kernel function to the grid
   void addKernel( const KernelFunctions& kernel );
+/// add a Gaussian with diagonal metric, height*exp(-0.5*sum_i ((x_i-center_i)*invsigma_i)^2),
+/// on the (2*nneigh_i+1) points around center along each direction.
+/// Points where the exponent is larger than cutoff are skipped.
+/// The Gaussian is factorized in one-dimensional tables that are combined with an outer product,
+/// so that only one exponential per grid line has to be computed
+  void addSeparableGaussian( const std::vector<double>& center, const std::vector<double>& invsigma, double height,
+                             const std::vector<unsigned>& nneigh, double cutoff=std::numeric_limits<double>::max() );
 
 /// get minimum value
   virtual double getMinValue() const = 0;
@@ -287,17 +295,50 @@ public:
 };
 
 
+/// A grid that only stores the regions that have been visited.
+/// The grid is split in tiles of fixed size, which are allocated the first time
+/// one of their points is accessed and stored densely. Tiles are found with an
+/// open-addressing hash table, so that memory is proportional to the explored region
+/// and access is almost as fast as for a dense grid.
 class SparseGrid : public GridBase
 {
-
-  std::map<index_t,double> map_;
-  std::map< index_t,std::vector<double> > der_;
-
+/// number of points of a tile along each dimension
+  std::vector<unsigned> tilebin_;
+/// number of points in a tile
+  unsigned tilesize_;
+/// precomputed stencil: for each dimension and each bin, contribution to the index of the tile
+  std::vector<std::vector<index_t>> tilestencil_;
+/// precomputed stencil: for each dimension and each bin, contribution to the offset within the tile
+  std::vector<std::vector<unsigned>> offsetstencil_;
+/// hash table with the index of the tile (or emptykey) and the position of the tile in the storage
+  std::vector<index_t> hashkeys_;
+  std::vector<unsigned> hashslots_;
+/// log2 of the size of the hash table
+  unsigned hashbits_;
+/// number of tiles in the storage
+  unsigned ntiles_;
+/// values and derivatives, stored tile by tile
+  std::vector<double> values_;
+  std::vector<double> derivs_;
+/// flags for the points that have been visited, stored tile by tile
+  std::vector<unsigned char> visited_;
+/// list of the visited points
+  std::vector<index_t> visitedlist_;
+  static constexpr index_t emptykey=std::numeric_limits<index_t>::max();
+/// find the tile containing a point and the offset within the tile
+  void locate(index_t index, index_t& tile, unsigned& offset) const;
+/// position of the hash table where a tile is or should be inserted
+  unsigned hashPosition(index_t tile) const;
+/// get the position in the storage of the point, or -1 if the tile was not allocated
+  long findPoint(index_t index) const;
+/// get the position in the storage of the point, allocating the tile if necessary
+  index_t allocatePoint(index_t index);
+/// rebuild the hash table with a larger size
+  void rehash();
 public:
   SparseGrid(const std::string& funcl, const std::vector<Value*> & args, const std::vector<std::string> & gmin,
              const std::vector<std::string> & gmax,
-             const std::vector<unsigned> & nbin, bool dospline, bool usederiv):
-    GridBase(funcl,args,gmin,gmax,nbin,dospline,usederiv) {}
+             const std::vector<unsigned> & nbin, bool dospline, bool usederiv);
 
   index_t getSize() const override;
   index_t getMaxSize() const;
@@ -28,16 +28,35 @@
 #include "Tools.h"
 #include <cstdarg>
 #include <cstring>
+#include <cstdio>
 #include <cmath>
 
 #include <iostream>
 #include <string>
+#include <algorithm>
 #ifdef __PLUMED_HAS_ZLIB
 #include <zlib.h>
 #endif
+#if defined(__unix__) || defined(__APPLE__)
+#include <sys/mman.h>
+#endif
 
 namespace PLMD {
 
+namespace {
+/// Read a value from a binary buffer, possibly changing its endianness
+template<class T>
+T readBinary(const char*ptr,bool swap) {
+  T t;
+  std::memcpy(&t,ptr,sizeof(T));
+  if(swap) {
+    char* c=reinterpret_cast<char*>(&t);
+    std::reverse(c,c+sizeof(T));
+  }
+  return t;
+}
+}
+
 size_t IFile::llread(char*ptr,size_t s) {
   plumed_assert(fp);
   size_t r;
@@ -58,8 +77,125 @@ size_t IFile::llread(char*ptr,size_t s) {
   return r;
 }
 
+bool IFile::binaryAvailable(std::size_t n) {
+  if(binaryOffset+n<=binarySize) return true;
+// the file might have grown since it was last mapped (e.g. when written by another walker)
+  if(std::fseek(fp,0,SEEK_END)!=0) return false;
+  long end=std::ftell(fp);
+  if(end<0 || std::size_t(end)<=binarySize) return false;
+  std::size_t size=end;
+#if defined(__unix__) || defined(__APPLE__)
+  if(binaryBuffer.empty()) {
+    void* ptr=mmap(NULL,size,PROT_READ,MAP_SHARED,fileno(fp),0);
+    if(ptr!=MAP_FAILED) {
+      binaryRelease();
+      binaryData=static_cast<const char*>(ptr);
+      binarySize=size;
+      binaryMapped=true;
+      return binaryOffset+n<=binarySize;
+    }
+  }
+  if(binaryMapped) {
+    binaryBuffer.assign(binaryData,binaryData+binarySize);
+    munmap(const_cast<char*>(binaryData),binarySize);
+    binaryMapped=false;
+  }
+#endif
+// fall back to reading the new bytes in a buffer
+  binaryBuffer.resize(size);
+  std::fseek(fp,binarySize,SEEK_SET);
+  std::size_t r=std::fread(binaryBuffer.data()+binarySize,1,size-binarySize,fp);
+  binaryBuffer.resize(binarySize+r);
+  binaryData=binaryBuffer.data();
+  binarySize=binaryBuffer.size();
+  return binaryOffset+n<=binarySize;
+}
+
+void IFile::binaryRelease() {
+#if defined(__unix__) || defined(__APPLE__)
+  if(binaryMapped) munmap(const_cast<char*>(binaryData),binarySize);
+#endif
+  binaryMapped=false;
+  binaryBuffer.clear();
+  binaryData=NULL;
+  binarySize=0;
+}
+
+bool IFile::readBinaryHeader() {
+// read everything starting from a local offset, so that
+// an incomplete header is read again from scratch later
+  std::size_t pos=binaryOffset;
+  auto available=[&](std::size_t n) {return binaryAvailable(pos-binaryOffset+n);};
+  auto readUnsigned=[&](std::uint32_t & n) {
+    if(!available(sizeof(n))) return false;
+    n=readBinary<std::uint32_t>(binaryData+pos,binarySwap);
+    pos+=sizeof(n);
+    return true;
+  };
+  auto readString=[&](std::string & str) {
+    std::uint32_t len;
+    if(!readUnsigned(len) || !available(len)) return false;
+    str.assign(binaryData+pos,len);
+    pos+=len;
+    return true;
+  };
+  if(!available(sizeof(binaryMagic))) return false;
+  if(std::memcmp(binaryData+pos,binaryMagic,sizeof(binaryMagic)-1)!=0) plumed_merror("file " + getPath() + ": corrupted binary file");
+  if((unsigned char)binaryData[pos+sizeof(binaryMagic)-1]!=binaryVersion) plumed_merror("file " + getPath() + ": unsupported version of binary file");
+  pos+=sizeof(binaryMagic);
+  if(!available(sizeof(std::uint32_t))) return false;
+  binarySwap=false;
+  if(readBinary<std::uint32_t>(binaryData+pos,false)!=binaryEndianTag) {
+    if(readBinary<std::uint32_t>(binaryData+pos,true)!=binaryEndianTag) plumed_merror("file " + getPath() + ": corrupted binary file");
+    binarySwap=true;
+  }
+  pos+=sizeof(std::uint32_t);
+  std::vector<Field> newfields;
+  std::uint32_t n;
+  if(!readUnsigned(n)) return false;
+  for(unsigned i=0; i<n; i++) {
+    Field field;
+    if(!readString(field.name)) return false;
+    newfields.push_back(field);
+  }
+  if(!readUnsigned(n)) return false;
+  for(unsigned i=0; i<n; i++) {
+    Field field;
+    field.constant=true;
+    if(!readString(field.name) || !readString(field.value)) return false;
+    newfields.push_back(field);
+  }
+  fields.swap(newfields);
+  binaryOffset=pos;
+  return true;
+}
+
+IFile& IFile::advanceBinaryField() {
+  while(true) {
+    if(!binaryAvailable(1)) {eof=true; return *this;}
+    if(binaryData[binaryOffset]==0) {
+      std::size_t nf=0;
+      for(const auto & f : fields) if(!f.constant) nf++;
+      std::size_t size=1+nf*sizeof(double);
+      if(!binaryAvailable(size)) {eof=true; return *this;}
+      const char* ptr=binaryData+binaryOffset+1;
+      for(auto & f : fields) {
+        if(f.constant) continue;
+        f.number=readBinary<double>(ptr,binarySwap);
+        f.read=false;
+        ptr+=sizeof(double);
+      }
+      binaryOffset+=size;
+      break;
+    } else if(!readBinaryHeader()) {eof=true; return *this;}
+  }
+  inMiddleOfField=true;
+  return *this;
+}
+
 IFile& IFile::advanceField() {
   plumed_assert(!inMiddleOfField);
+  if(binary) return advanceBinaryField();
   std::string line;
   bool done=false;
   while(!done) {
@@ -109,6 +245,9 @@ IFile& IFile::open(const std::string&path) {
   err=false;
   fp=NULL;
   gzfp=NULL;
+  binaryRelease();
+  binary=false;
+  binaryOffset=0;
   bool do_exist=FileExist(path);
   plumed_massert(do_exist,"file " + path + " cannot be found");
   fp=std::fopen(const_cast<char*>(this->path.c_str()),"r");
@@ -118,11 +257,32 @@ IFile& IFile::open(const std::string&path) {
 #else
     plumed_merror("file " + getPath() + ": trying to use a gz file without zlib being linked");
 #endif
+  } else if(fp) {
+// detect binary files from their magic string
+    int c=std::getc(fp);
+    if(c==binaryMagic[0]) {
+      char magic[sizeof(binaryMagic)-1];
+      magic[0]=c;
+      std::size_t r=std::fread(magic+1,1,sizeof(magic)-1,fp);
+      binary=(r==sizeof(magic)-1 && std::memcmp(magic,binaryMagic,sizeof(magic))==0);
+      std::fseek(fp,0,SEEK_SET);
+    } else if(c!=EOF) std::ungetc(c,fp);
   }
   if(plumed) plumed->insertFile(*this);
   return *this;
 }
 
+void IFile::close() {
+  binaryRelease();
+  binary=false;
+  binaryOffset=0;
+  FileBase::close();
+}
+
+bool IFile::isBinary()const {
+  return binary;
+}
+
 IFile& IFile::scanFieldList(std::vector<std::string>&s) {
   if(!inMiddleOfField) advanceField();
 // using explicit conversion not to confuse cppcheck 1.86
@@ -134,11 +294,16 @@ IFile& IFile::scanFieldList(std::vector<std::string>&s) {
 }
 
 bool IFile::FieldExist(const std::string& s) {
-  std::vector<std::string> slist;
-  scanFieldList(slist);
-  int mycount = (int) std::count(slist.begin(), slist.end(), s);
-  if(mycount>0) return true;
-  else return false;
+  if(!inMiddleOfField) advanceField();
+// using explicit conversion not to confuse cppcheck 1.86
+  if(!bool(*this)) return false;
+  for(const auto & f : fields) if(f.name==s) return true;
+  return false;
+}
+
+bool IFile::FieldIsConstant(const std::string& s) {
+  if(!FieldExist(s)) return false;
+  return fields[findField(s)].constant;
 }
 
 IFile& IFile::scanField(const std::string&name,std::string&str) {
@@ -146,12 +311,26 @@ IFile& IFile::scanField(const std::string&name,std::string&str) {
 // using explicit conversion not to confuse cppcheck 1.86
   if(!bool(*this)) return *this;
   unsigned i=findField(name);
-  str=fields[i].value;
+  if(binary && !fields[i].constant) {
+    char buffer[32];
+    std::snprintf(buffer,sizeof(buffer),"%.17g",fields[i].number);
+    str=buffer;
+  } else str=fields[i].value;
   fields[i].read=true;
   return *this;
 }
 
 IFile& IFile::scanField(const std::string&name,double &x) {
+// numbers in binary files are used directly, without any conversion
+  if(binary) {
+    if(!inMiddleOfField) advanceField();
+    if(!bool(*this)) return *this;
+    unsigned i=findField(name);
+    if(fields[i].constant) Tools::convert(fields[i].value,x);
+    else x=fields[i].number;
+    fields[i].read=true;
+    return *this;
+  }
   std::string str;
   scanField(name,str);
   if(*this) Tools::convert(str,x);
@@ -159,6 +338,12 @@ IFile& IFile::scanField(const std::string&name,double &x) {
 }
 
 IFile& IFile::scanField(const std::string&name,int &x) {
+  if(binary) {
+    double d=0.0;
+    scanField(name,d);
+    if(*this) x=int(d);
+    return *this;
+  }
   std::string str;
   scanField(name,str);
   if(*this) Tools::convert(str,x);
@@ -193,15 +378,23 @@ IFile& IFile::scanField() {
 IFile::IFile():
   inMiddleOfField(false),
   ignoreFields(false),
-  noEOL(false)
+  noEOL(false),
+  binary(false),
+  binarySwap(false),
+  binaryMapped(false),
+  binaryData(NULL),
+  binarySize(0),
+  binaryOffset(0)
 {
 }
 
 IFile::~IFile() {
   if(inMiddleOfField) std::cerr<<"WARNING: IFile closed in the middle of reading. seems strange!\n";
+  binaryRelease();
 }
 
 IFile& IFile::getline(std::string &str) {
+  plumed_massert(!binary,"file " + getPath() + ": binary files can only be read by fields");
   char tmp=0;
   str="";
   fpos_t pos;
@@ -249,6 +442,19 @@ void IFile::reset(bool reset) {
   return;
 }
 
+bool IFile::hasNewData() {
+  plumed_assert(fp);
+  if(gzfp) return true;
+  if(binary) return binaryAvailable(1);
+  fpos_t pos;
+  fgetpos(fp,&pos);
+  long current=std::ftell(fp);
+  std::fseek(fp,0,SEEK_END);
+  long end=std::ftell(fp);
+  fsetpos(fp,&pos);
+  return end>current;
+}
+
 void IFile::allowIgnoredFields() {
   ignoreFields=true;
 }
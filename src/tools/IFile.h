@@ -44,7 +44,9 @@ class IFile:
     public FieldBase {
   public:
     bool read;
-    Field(): read(false) {}
+/// Value of non-constant fields of binary files
+    double number;
+    Field(): read(false), number(0.0) {}
   };
 /// Low-level read.
 /// Note: in parallel, all processes read
@@ -57,8 +59,32 @@ class IFile:
   bool ignoreFields;
 /// Set to true to allow files without end-of-line at the end
   bool noEOL;
+/// True if the file is a binary fielded file (see FileBase::binaryMagic)
+  bool binary;
+/// True if the binary file was written with a different endianness
+  bool binarySwap;
+/// True if binaryData is memory mapped
+  bool binaryMapped;
+/// Content of a binary file
+  const char* binaryData;
+/// Number of bytes available in binaryData
+  std::size_t binarySize;
+/// Offset of the next block to be read from binaryData
+  std::size_t binaryOffset;
+/// Buffer used in place of memory mapping when the latter is not available
+  std::vector<char> binaryBuffer;
+/// Make n bytes after binaryOffset available, mapping again the file if it has grown.
+/// Returns false if the file is not long enough.
+  bool binaryAvailable(std::size_t n);
+/// Release the content of a binary file
+  void binaryRelease();
+/// Read a header block of a binary file.
+/// Returns false if the header is not complete yet
+  bool readBinaryHeader();
 /// Advance to next field (= read one line)
   IFile& advanceField();
+/// Advance to next field in a binary file (= read one record)
+  IFile& advanceBinaryField();
 /// Find field index by name
   unsigned findField(const std::string&name)const;
 public:
@@ -66,8 +92,14 @@ public:
   IFile();
 /// Destructor
   ~IFile();
-/// Opens the file
+/// Opens the file.
+/// Binary fielded files (see OFile::setBinary()) are detected automatically
+/// and, when possible, memory mapped.
   IFile& open(const std::string&name) override;
+/// Closes the file
+  void close() override;
+/// Check if the file is a binary fielded file
+  bool isBinary()const;
 /// Gets the list of all fields
   IFile& scanFieldList(std::vector<std::string>&);
 /// Read a double field
@@ -89,8 +121,14 @@ public:
   IFile& getline(std::string&);
 /// Reset end of file
   void reset(bool);
+/// Check if the file has grown since the last read.
+/// Useful to avoid parsing again files that are being written by
+/// someone else. For compressed files it always returns true.
+  bool hasNewData();
 /// Check if a field exist
   bool FieldExist(const std::string& s);
+/// Check if a field exist and is constant (i.e. set with "#! SET" in text files)
+  bool FieldIsConstant(const std::string& s);
 /// Read in a value
   IFile& scanField(Value* val);
 /// Allow some of the fields in the input to be ignored
@@ -57,6 +57,12 @@ public:
   double getCutoff( const double& width ) const ;
 /// Get the position of the center
   std::vector<double> getCenter() const;
+/// Get the widths
+  std::vector<double> getWidth() const;
+/// Get the height
+  double getHeight() const;
+/// Check if this is a Gaussian with a diagonal metric, which can be factorized along the dimensions
+  bool isSeparableGaussian() const;
 /// Get the support
   std::vector<unsigned> getSupport( const std::vector<double>& dx ) const;
 /// get it in continuous form
@@ -89,5 +95,20 @@ std::vector<double> KernelFunctions::getCenter() const {
   return center;
 }
 
+inline
+std::vector<double> KernelFunctions::getWidth() const {
+  return width;
+}
+
+inline
+double KernelFunctions::getHeight() const {
+  return height;
+}
+
+inline
+bool KernelFunctions::isSeparableGaussian() const {
+  return dtype==diagonal && (ktype==gaussian || ktype==truncatedgaussian);
+}
+
 }
 #endif
@@ -24,6 +24,9 @@
 #include "Pbc.h"
 #include "AtomNumber.h"
 #include "Tools.h"
+#include "LinkCells.h"
+#include "Communicator.h"
+#include "OpenMP.h"
 #include <vector>
 #include <algorithm>
 
@@ -32,9 +35,10 @@ using namespace std;
 
 NeighborList::NeighborList(const vector<AtomNumber>& list0, const vector<AtomNumber>& list1,
                            const bool& do_pair, const bool& do_pbc, const Pbc& pbc,
-                           const double& distance, const unsigned& stride): reduced(false),
+                           const double& distance, const unsigned& stride,
+                           const double& skin): reduced(false),
   do_pair_(do_pair), do_pbc_(do_pbc), pbc_(&pbc),
-  distance_(distance), stride_(stride)
+  distance_(distance), skin_(skin), stride_(stride), nupdates_(0)
 {
 // store full list of atoms needed
   fullatomlist_=list0;
@@ -55,9 +59,9 @@ NeighborList::NeighborList(const vector<AtomNumber>& list0, const vector<AtomNum
 
 NeighborList::NeighborList(const vector<AtomNumber>& list0, const bool& do_pbc,
                            const Pbc& pbc, const double& distance,
-                           const unsigned& stride): reduced(false),
+                           const unsigned& stride, const double& skin): reduced(false),
   do_pbc_(do_pbc), pbc_(&pbc),
-  distance_(distance), stride_(stride) {
+  distance_(distance), skin_(skin), stride_(stride), nupdates_(0) {
   fullatomlist_=list0;
   nlist0_=list0.size();
   twolists_=false;
@@ -94,23 +98,115 @@ pair<unsigned,unsigned> NeighborList::getIndexPair(unsigned ipair) {
 
 void NeighborList::update(const vector<Vector>& positions) {
   neighbors_.clear();
-  const double d2=distance_*distance_;
 // check if positions array has the correct length
   plumed_assert(positions.size()==fullatomlist_.size());
-  for(unsigned int i=0; i<nallpairs_; ++i) {
-    pair<unsigned,unsigned> index=getIndexPair(i);
-    unsigned index0=index.first;
-    unsigned index1=index.second;
-    Vector distance;
-    if(do_pbc_) {
-      distance=pbc_->distance(positions[index0],positions[index1]);
-    } else {
-      distance=delta(positions[index0],positions[index1]);
+// with PAIR there are only nlist0_ candidates, so there is nothing to gain from link cells
+  if(twolists_ && do_pair_) {
+    const double d2=(distance_+skin_)*(distance_+skin_);
+    for(unsigned int i=0; i<nallpairs_; ++i) {
+      pair<unsigned,unsigned> index=getIndexPair(i);
+      if(modulo2(getDistance(positions[index.first],positions[index.second]))<=d2) neighbors_.push_back(index);
     }
-    double value=modulo2(distance);
-    if(value<=d2) {neighbors_.push_back(index);}
+  } else {
+    updateWithLinkCells(positions);
   }
   setRequestList();
+  if(skin_>0.0) {
+    lastpositions_=positions;
+    lastbox_=pbc_->getBox();
+  }
+  nupdates_++;
+}
+
+bool NeighborList::isUpdateNeeded(const vector<Vector>& positions) const {
+  if(lastpositions_.size()!=positions.size()) return true;
+// a change in the box can bring periodic images closer, so it is
+// conservatively added to the displacement of the atoms
+  double boxchange=0.0;
+  if(do_pbc_) {
+    const Tensor box(pbc_->getBox()-lastbox_);
+    for(unsigned k=0; k<3; ++k) boxchange=std::max(boxchange,box.getRow(k).modulo());
+  }
+  const double maxdisp=0.5*skin_-boxchange;
+  if(maxdisp<=0.0) return true;
+  const double maxdisp2=maxdisp*maxdisp;
+  for(unsigned i=0; i<positions.size(); ++i) {
+    if(modulo2(getDistance(lastpositions_[i],positions[i]))>maxdisp2) return true;
+  }
+  return false;
+}
+
+Vector NeighborList::getDistance(const Vector& p0,const Vector& p1) const {
+  if(do_pbc_) return pbc_->distance(p0,p1);
+  return delta(p0,p1);
+}
+
+void NeighborList::updateWithLinkCells(const vector<Vector>& positions) {
+// pairs within the skin are included, so that the list remains valid while atoms move
+  const double cutoff=distance_+skin_;
+  const double d2=cutoff*cutoff;
+// atoms that are put in the link cells: the second list, or the only list
+  const unsigned nfirst=(twolists_ ? nlist0_ : 0);
+  const unsigned ncells_atoms=positions.size()-nfirst;
+  if(nlist0_==0 || ncells_atoms==0) return;
+
+// Link cells need a box. When pbc are not used (or the box is not set)
+// a fictitious box enclosing all the atoms is used instead. Periodic images in
+// this box might only add spurious candidates, which are then discarded
+// when the actual distance is computed.
+  Pbc cellpbc;
+  if(do_pbc_ && pbc_->isSet()) {
+    cellpbc.setBox(pbc_->getBox());
+  } else {
+    Vector pmin(positions[0]),pmax(positions[0]);
+    for(unsigned i=1; i<positions.size(); ++i) for(unsigned k=0; k<3; ++k) {
+        pmin[k]=std::min(pmin[k],positions[i][k]);
+        pmax[k]=std::max(pmax[k],positions[i][k]);
+      }
+    Vector side(pmax-pmin);
+    cellpbc.setBox(Tensor(side[0]+cutoff,0.0,0.0,0.0,side[1]+cutoff,0.0,0.0,0.0,side[2]+cutoff));
+  }
+
+// link cells are built serially on a private communicator,
+// since the neighbor list is not split among processes
+  Communicator serialcomm;
+  LinkCells linkcells(serialcomm);
+  linkcells.setCutoff(cutoff);
+  std::vector<Vector> cellpos(positions.begin()+nfirst,positions.end());
+  std::vector<unsigned> cellind(ncells_atoms);
+  for(unsigned i=0; i<ncells_atoms; ++i) cellind[i]=nfirst+i;
+  linkcells.buildCellLists(cellpos,cellind,cellpbc);
+
+  unsigned nt=OpenMP::getNumThreads();
+  if(nt*10>nlist0_) nt=1;
+// static scheduling assigns contiguous blocks of atoms to threads in order,
+// so that concatenating the per-thread lists reproduces the ordering
+// obtained looping over all pairs
+  std::vector<std::vector<std::pair<unsigned,unsigned> > > omp_neighbors(nt);
+
+  #pragma omp parallel num_threads(nt)
+  {
+    std::vector<std::pair<unsigned,unsigned> > & my_neighbors(omp_neighbors[OpenMP::getThreadNum()]);
+    std::vector<unsigned> cells_required(linkcells.getNumberOfCells());
+    std::vector<unsigned> candidates(1+ncells_atoms);
+    std::vector<unsigned> close;
+    #pragma omp for schedule(static)
+    for(unsigned int i=0; i<nlist0_; ++i) {
+// the first element is skipped by LinkCells. For two lists it is not an index in the link cells
+      candidates[0]=i;
+      unsigned natomsper=1;
+      linkcells.retrieveNeighboringAtoms(positions[i],cells_required,natomsper,candidates);
+      close.clear();
+      for(unsigned j=1; j<natomsper; ++j) {
+        const unsigned jj=candidates[j];
+        if(!twolists_ && jj<=i) continue;
+        if(modulo2(getDistance(positions[i],positions[jj]))<=d2) close.push_back(jj);
+      }
+      std::sort(close.begin(),close.end());
+      for(const auto & jj : close) my_neighbors.push_back(pair<unsigned,unsigned>(i,jj));
+    }
+  }
+  for(const auto & t : omp_neighbors) neighbors_.insert(neighbors_.end(),t.begin(),t.end());
 }
 
 void NeighborList::setRequestList() {
@@ -124,15 +220,21 @@ void NeighborList::setRequestList() {
 }
 
 vector<AtomNumber>& NeighborList::getReducedAtomList() {
-  if(!reduced)for(unsigned int i=0; i<size(); ++i) {
-      unsigned newindex0=0,newindex1=0;
-      AtomNumber index0=fullatomlist_[neighbors_[i].first];
-      AtomNumber index1=fullatomlist_[neighbors_[i].second];
-// I exploit the fact that requestlist_ is an ordered vector
-      auto p = std::find(requestlist_.begin(), requestlist_.end(), index0); plumed_assert(p!=requestlist_.end()); newindex0=p-requestlist_.begin();
-      p = std::find(requestlist_.begin(), requestlist_.end(), index1); plumed_assert(p!=requestlist_.end()); newindex1=p-requestlist_.begin();
-      neighbors_[i]=pair<unsigned,unsigned>(newindex0,newindex1);
+  if(!reduced) {
+// position of each atom of the full list in the (ordered) request list
+    std::vector<unsigned> newindex(fullatomlist_.size(),0);
+    if(!requestlist_.empty()) {
+      std::vector<unsigned> requestindex(requestlist_.back().index()+1,0);
+      for(unsigned i=0; i<requestlist_.size(); ++i) requestindex[requestlist_[i].index()]=i;
+      for(unsigned i=0; i<fullatomlist_.size(); ++i) {
+        const unsigned index=fullatomlist_[i].index();
+        if(index<requestindex.size()) newindex[i]=requestindex[index];
+      }
     }
+    for(unsigned int i=0; i<size(); ++i) {
+      neighbors_[i]=pair<unsigned,unsigned>(newindex[neighbors_[i].first],newindex[neighbors_[i].second]);
+    }
+  }
   reduced=true;
   return requestlist_;
 }
@@ -141,6 +243,14 @@ unsigned NeighborList::getStride() const {
   return stride_;
 }
 
+double NeighborList::getSkin() const {
+  return skin_;
+}
+
+unsigned NeighborList::getNumberOfUpdates() const {
+  return nupdates_;
+}
+
 unsigned NeighborList::getLastUpdate() const {
   return lastupdate_;
 }
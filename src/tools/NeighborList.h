@@ -23,6 +23,7 @@
 #define __PLUMED_tools_NeighborList_h
 
 #include "Vector.h"
+#include "Tensor.h"
 #include "AtomNumber.h"
 
 #include <vector>
@@ -40,8 +41,11 @@ class NeighborList
   const PLMD::Pbc* pbc_;
   std::vector<PLMD::AtomNumber> fullatomlist_,requestlist_;
   std::vector<std::pair<unsigned,unsigned> > neighbors_;
-  double distance_;
-  unsigned stride_,nlist0_,nlist1_,nallpairs_,lastupdate_;
+  double distance_,skin_;
+  unsigned stride_,nlist0_,nlist1_,nallpairs_,lastupdate_,nupdates_;
+/// Positions and box at the last update, used to check the skin
+  std::vector<PLMD::Vector> lastpositions_;
+  PLMD::Tensor lastbox_;
 /// Initialize the neighbor list with all possible pairs
   void initialize();
 /// Return the pair of indexes in the positions array
@@ -49,14 +53,19 @@ class NeighborList
   std::pair<unsigned,unsigned> getIndexPair(unsigned i);
 /// Extract the list of atoms from the current list of close pairs
   void setRequestList();
+/// Distance between two positions, using pbc if required
+  Vector getDistance(const Vector& p0,const Vector& p1) const;
+/// Rebuild the list of close pairs using link cells
+  void updateWithLinkCells(const std::vector<PLMD::Vector>& positions);
 public:
   NeighborList(const std::vector<PLMD::AtomNumber>& list0,
                const std::vector<PLMD::AtomNumber>& list1,
                const bool& do_pair, const bool& do_pbc, const PLMD::Pbc& pbc,
-               const double& distance=1.0e+30, const unsigned& stride=0);
+               const double& distance=1.0e+30, const unsigned& stride=0,
+               const double& skin=0.0);
   NeighborList(const std::vector<PLMD::AtomNumber>& list0, const bool& do_pbc,
                const PLMD::Pbc& pbc, const double& distance=1.0e+30,
-               const unsigned& stride=0);
+               const unsigned& stride=0, const double& skin=0.0);
 /// Return the list of all atoms. These are needed to rebuild the neighbor list.
   std::vector<PLMD::AtomNumber>& getFullAtomList();
 /// Update the indexes in the neighbor list to match the
@@ -68,6 +77,12 @@ public:
   void update(const std::vector<PLMD::Vector>& positions);
 /// Get the update stride of the neighbor list
   unsigned getStride() const;
+/// Get the skin of the neighbor list
+  double getSkin() const;
+/// Check if some atom moved more than half the skin since the last update
+  bool isUpdateNeeded(const std::vector<PLMD::Vector>& positions) const;
+/// Get the number of times the neighbor list was updated
+  unsigned getNumberOfUpdates() const;
 /// Get the last step in which the neighbor list was updated
   unsigned getLastUpdate() const;
 /// Set the step of the last update
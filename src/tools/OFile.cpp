@@ -36,6 +36,12 @@
 
 #include <memory>
 #include <utility>
+#include <algorithm>
+#include <thread>
+#include <mutex>
+#include <condition_variable>
+#include <deque>
+#include <system_error>
 
 #ifdef __PLUMED_HAS_ZLIB
 #include <zlib.h>
@@ -43,20 +49,115 @@
 
 namespace PLMD {
 
+/// Lines written to an asynchronous OFile are stored in a bounded queue.
+/// A background thread takes all the pending lines at once and writes them with
+/// a single call. Flush requests are queued as well, so that also heavy flushes
+/// (close/reopen) are done in background.
+class OFile::AsyncWriter {
+/// The file where data is written
+  OFile& file;
+/// Maximum number of chunks in the queue
+  unsigned maxsize;
+/// Pending chunks. An empty string is a flush request
+  std::deque<std::string> queue;
+/// True while the background thread is writing data taken from the queue
+  bool busy;
+/// True when the background thread should stop
+  bool stop;
+  std::mutex mtx;
+/// Notified when new data is available
+  std::condition_variable notEmpty;
+/// Notified when data has been removed from the queue or written
+  std::condition_variable progress;
+  std::thread thread;
+/// Main loop of the background thread
+  void run() {
+    std::deque<std::string> chunks;
+    std::string batch;
+    while(true) {
+      {
+        std::unique_lock<std::mutex> lock(mtx);
+        notEmpty.wait(lock,[this] {return stop || !queue.empty();});
+        if(queue.empty()) return;
+        chunks.swap(queue);
+        busy=true;
+      }
+      progress.notify_all();
+      batch.clear();
+      for(const auto & c : chunks) {
+        if(c.empty()) {
+          if(!batch.empty()) file.rawWrite(batch.c_str(),batch.length());
+          batch.clear();
+          file.rawFlush();
+        } else batch+=c;
+      }
+      if(!batch.empty()) file.rawWrite(batch.c_str(),batch.length());
+      chunks.clear();
+      {
+        std::lock_guard<std::mutex> lock(mtx);
+        busy=false;
+      }
+      progress.notify_all();
+    }
+  }
+public:
+  AsyncWriter(OFile& file,unsigned maxsize):
+    file(file),
+    maxsize(maxsize),
+    busy(false),
+    stop(false),
+    thread(&AsyncWriter::run,this)
+  {}
+/// Add a chunk to the queue, waiting if it is full
+  void push(std::string && chunk) {
+    {
+      std::unique_lock<std::mutex> lock(mtx);
+      progress.wait(lock,[this] {return queue.size()<maxsize;});
+      queue.push_back(std::move(chunk));
+    }
+    notEmpty.notify_one();
+  }
+/// Wait until all the pending data has been written
+  void wait() {
+    std::unique_lock<std::mutex> lock(mtx);
+    progress.wait(lock,[this] {return queue.empty() && !busy;});
+  }
+  ~AsyncWriter() {
+    {
+      std::lock_guard<std::mutex> lock(mtx);
+      stop=true;
+    }
+    notEmpty.notify_one();
+    thread.join();
+  }
+};
+
+size_t OFile::rawWrite(const char*ptr,size_t s) {
+  size_t r=0;
+  if(!fp) plumed_merror("writing on uninitilized File");
+  if(gzfp) {
+#ifdef __PLUMED_HAS_ZLIB
+    r=gzwrite(gzFile(gzfp),ptr,s);
+#else
+    plumed_merror("file " + getPath() + ": trying to use a gz file without zlib being linked");
+#endif
+  } else {
+    r=fwrite(ptr,1,s,fp);
+  }
+  return r;
+}
+
 size_t OFile::llwrite(const char*ptr,size_t s) {
   size_t r;
   if(linked) return linked->llwrite(ptr,s);
+// in asynchronous mode data is only queued, and processes do not need to be synchronized
+  if(async) {
+    async->push(std::string(ptr,s));
+    return s;
+  }
+  if(comm && comm->Get_rank()>0 && isAsync()) return s;
   if(! (comm && comm->Get_rank()>0)) {
-    if(!fp) plumed_merror("writing on uninitilized File");
-    if(gzfp) {
-#ifdef __PLUMED_HAS_ZLIB
-      r=gzwrite(gzFile(gzfp),ptr,s);
-#else
-      plumed_merror("file " + getPath() + ": trying to use a gz file without zlib being linked");
-#endif
-    } else {
-      r=fwrite(ptr,1,s,fp);
-    }
+    r=rawWrite(ptr,s);
   }
 //  This barrier is apparently useless since it comes
 //  just before a Bcast.
@@ -76,7 +177,9 @@ OFile::OFile():
   fieldChanged(false),
   backstring("bck"),
   enforceRestart_(false),
-  enforceBackup_(false)
+  enforceBackup_(false),
+  asyncMode(false),
+  binary(false)
 {
   fmtField();
   buflen=1;
@@ -90,6 +193,7 @@ OFile::OFile():
 }
 
 OFile& OFile::link(OFile&l) {
+  waitAsync();
   fp=NULL;
   gzfp=NULL;
   linked=&l;
@@ -102,6 +206,7 @@ OFile& OFile::setLinePrefix(const std::string&l) {
 }
 
 int OFile::printf(const char*fmt,...) {
+  plumed_massert(!binary,"file " + getPath() + ": only fields can be written in binary files");
   va_list arg;
   va_start(arg, fmt);
   int r=std::vsnprintf(&buffer[actual_buffer_length],buflen-actual_buffer_length,fmt,arg);
@@ -168,6 +273,14 @@ OFile& OFile::printField(const std::string&name,double v) {
 // The distinction between +nan and -nan is not well defined
 // Always printing nan simplifies some regtest (special functions computed our of range).
   if(std::isnan(v)) v=std::numeric_limits<double>::quiet_NaN();
+// in binary files numbers are stored with full precision and without formatting
+  if(binary && std::none_of(const_fields.begin(),const_fields.end(),[&](const Field&f) {return f.name==name;})) {
+    Field field;
+    field.name=name;
+    field.number=v;
+    fields.push_back(field);
+    return *this;
+  }
   sprintf(buffer_string.get(),fieldFmt.c_str(),v);
   printField(name,buffer_string.get());
   return *this;
@@ -186,6 +299,8 @@ OFile& OFile::printField(const std::string&name,const std::string & v) {
     Field field;
     field.name=name;
     field.value=v;
+    if(binary && !Tools::convert(v,field.number))
+      plumed_merror("file " + getPath() + ": field " + name + " cannot be written in a binary file since it is not a number");
     fields.push_back(field);
   } else {
     if(const_fields[i].value!=v) fieldChanged=true;
@@ -223,23 +338,59 @@ OFile& OFile::printField() {
         break;
       }
     }
-  if(reprint) {
-    printf("#! FIELDS");
-    for(unsigned i=0; i<fields.size(); i++) printf(" %s",fields[i].name.c_str());
-    printf("\n");
-    for(unsigned i=0; i<const_fields.size(); i++) {
-      printf("#! SET %s %s",const_fields[i].name.c_str(),const_fields[i].value.c_str());
+  if(binary) {
+    printBinaryField(reprint);
+  } else {
+    if(reprint) {
+      printf("#! FIELDS");
+      for(unsigned i=0; i<fields.size(); i++) printf(" %s",fields[i].name.c_str());
       printf("\n");
+      for(unsigned i=0; i<const_fields.size(); i++) {
+        printf("#! SET %s %s",const_fields[i].name.c_str(),const_fields[i].value.c_str());
+        printf("\n");
+      }
     }
+    for(unsigned i=0; i<fields.size(); i++) printf("%s",fields[i].value.c_str());
+    printf("\n");
   }
-  for(unsigned i=0; i<fields.size(); i++) printf("%s",fields[i].value.c_str());
-  printf("\n");
   previous_fields=fields;
   fields.clear();
   fieldChanged=false;
   return *this;
 }
 
+void OFile::printBinaryField(bool reprint) {
+// the extension is checked instead of gzfp, which can be reopened by the background writer
+  if(Tools::extension(getPath())=="gz") plumed_merror("file " + getPath() + ": binary files cannot be compressed");
+  std::string block;
+  auto appendUnsigned=[&](std::uint32_t n) {block.append(reinterpret_cast<const char*>(&n),sizeof(n));};
+  auto appendString=[&](const std::string & str) {appendUnsigned(str.length()); block+=str;};
+  if(reprint) {
+    block.append(binaryMagic,sizeof(binaryMagic)-1);
+    block.push_back(char(binaryVersion));
+    appendUnsigned(binaryEndianTag);
+    appendUnsigned(fields.size());
+    for(const auto & f : fields) appendString(f.name);
+    appendUnsigned(const_fields.size());
+    for(const auto & f : const_fields) {
+      appendString(f.name);
+      appendString(f.value);
+    }
+  }
+  block.push_back(0);
+  for(const auto & f : fields) block.append(reinterpret_cast<const char*>(&f.number),sizeof(f.number));
+  llwrite(block.c_str(),block.length());
+}
+
+OFile& OFile::setBinary() {
+  binary=true;
+  return *this;
+}
+
+bool OFile::isBinary()const {
+  return binary;
+}
+
 void OFile::setBackupString( const std::string& str ) {
   backstring=str;
 }
@@ -289,6 +440,7 @@ void OFile::backupFile( const std::string& bstring, const std::string& fname ) {
 
 OFile& OFile::open(const std::string&path) {
   plumed_assert(!cloned);
+  waitAsync();
   eof=false;
   err=false;
   fp=NULL;
@@ -326,6 +478,8 @@ OFile& OFile::rewind() {
 // we use here "hard" rewind, which means close/reopen
 // the reason is that normal rewind does not work when in append mode
 // moreover, we can take a backup of the file
+// pending asynchronous writes might reopen fp, so they are completed first
+  waitAsync();
   plumed_assert(fp);
   clearFields();
   if(gzfp) {
@@ -354,7 +508,50 @@ OFile& OFile::rewind() {
   return *this;
 }
 
+OFile::~OFile() {
+}
+
+OFile& OFile::setAsync(unsigned maxsize) {
+  if(linked) return *this;
+// a previous background writer is stopped, so that only one thread at a time uses fp
+  async.reset();
+  plumed_massert(fp,"file should be opened before switching to asynchronous mode");
+  plumed_assert(maxsize>0);
+  int failed=0;
+// only the process that actually writes needs a background thread
+  if(!(comm && comm->Get_rank()>0)) {
+    try {
+      async.reset(new AsyncWriter(*this,maxsize));
+    } catch(const std::system_error &) {
+      failed=1;
+    }
+  }
+  if(comm) comm->Sum(failed);
+  asyncMode=(failed==0);
+  return *this;
+}
+
+void OFile::waitAsync()const {
+  if(async) async->wait();
+}
+
+bool OFile::isAsync()const {
+  return asyncMode;
+}
+
+void OFile::close() {
+  async.reset();
+  asyncMode=false;
+  FileBase::close();
+}
+
 FileBase& OFile::flush() {
+  if(async) async->push(std::string());
+  else if(!isAsync()) rawFlush();
+  return *this;
+}
+
+void OFile::rawFlush() {
   if(heavyFlush) {
     if(gzfp) {
 #ifdef __PLUMED_HAS_ZLIB
@@ -374,7 +571,6 @@ FileBase& OFile::flush() {
     if(gzfp) gzflush(gzFile(gzfp),Z_FULL_FLUSH);
 #endif
   }
-  return *this;
 }
 
 bool OFile::checkRestart()const {
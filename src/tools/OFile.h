@@ -163,6 +163,10 @@ class OFile:
 /// Class identifying a single field for fielded output
   class Field:
     public FieldBase {
+  public:
+/// Value of non-constant fields of binary files
+    double number;
+    Field(): number(0.0) {}
   };
 /// Low-level write
   size_t llwrite(const char*,size_t);
@@ -192,9 +196,28 @@ class OFile:
   bool enforceRestart_;
 /// True if backup behavior (i.e. non restart) should be forced
   bool enforceBackup_;
+/// True if the file is in asynchronous mode (on all processes)
+  bool asyncMode;
+/// True if fields are written in binary format
+  bool binary;
+/// Write the current line in binary format
+  void printBinaryField(bool reprint);
+/// Write directly on the underlying file
+  size_t rawWrite(const char*,size_t);
+/// Flush directly the underlying file
+  void rawFlush();
+/// Background writer used in asynchronous mode
+  class AsyncWriter;
+/// Background writer, only allocated in asynchronous mode.
+/// Declared last so that it is destroyed (and its queue written) first
+  std::unique_ptr<AsyncWriter> async;
+/// Wait until the background writer has written all the pending data
+  void waitAsync()const override;
 public:
 /// Constructor
   OFile();
+/// Destructor
+  ~OFile();
 /// Allows overloading of link
   using FileBase::link;
 /// Allows overloading of open
@@ -258,6 +281,28 @@ public:
   OFile&rewind();
 /// Flush a file
   FileBase&flush() override;
+/// Close a file, after writing all the pending data in asynchronous mode
+  void close() override;
+/// Switch to asynchronous mode.
+/// Data is passed to a background thread, which writes it in batches
+/// and also takes care of flushing the file, so that the caller is not blocked.
+/// At most maxsize lines are kept in memory waiting to be written: when
+/// the queue is full the caller waits.
+/// Should be called after the file has been opened.
+/// If threads cannot be started the file silently stays synchronous.
+  OFile&setAsync(unsigned maxsize=1000);
+/// Check if the file is in asynchronous mode
+  bool isAsync()const;
+/// Write fields in binary format.
+/// Non-constant fields are stored as doubles with full precision and
+/// without any formatting, so that they can be read back much faster.
+/// The format is described in FileBase::binaryMagic and files
+/// are recognized automatically by IFile.
+/// Only fields can be written in a binary file, and only numbers
+/// can be stored in non-constant fields.
+  OFile&setBinary();
+/// Check if fields are written in binary format
+  bool isBinary()const;
 /// Enforce restart, also if the attached plumed object is not restarting.
 /// Useful for tests
   OFile&enforceRestart();
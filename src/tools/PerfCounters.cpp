@@ -0,0 +1,90 @@
+/* +++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++
+   Copyright (c) 2020 The plumed team
+   (see the PEOPLE file at the root of the distribution for a list of names)
+
+   See http://www.plumed.org for more information.
+
+   This file is part of plumed, version 2.
+
+   plumed is free software: you can redistribute it and/or modify
+   it under the terms of the GNU Lesser General Public License as published by
+   the Free Software Foundation, either version 3 of the License, or
+   (at your option) any later version.
+
+   plumed is distributed in the hope that it will be useful,
+   but WITHOUT ANY WARRANTY; without even the implied warranty of
+   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+   GNU Lesser General Public License for more details.
+
+   You should have received a copy of the GNU Lesser General Public License
+   along with plumed.  If not, see <http://www.gnu.org/licenses/>.
++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++ */
+#include "PerfCounters.h"
+
+#if defined(__linux__)
+#include <linux/perf_event.h>
+#include <sys/syscall.h>
+#include <unistd.h>
+#include <cerrno>
+#include <cstring>
+#endif
+
+namespace PLMD {
+
+const std::array<std::string,PerfCounters::n> & PerfCounters::getNames() {
+  static const std::array<std::string,n> names {{"cycles","instructions","cache-misses","branch-misses"}};
+  return names;
+}
+
+PerfCounters::PerfCounters() {
+  fd.fill(-1);
+#if defined(__linux__)
+  const std::array<unsigned long long,n> config {{
+      PERF_COUNT_HW_CPU_CYCLES,PERF_COUNT_HW_INSTRUCTIONS,PERF_COUNT_HW_CACHE_MISSES,PERF_COUNT_HW_BRANCH_MISSES
+    }
+  };
+  for(unsigned i=0; i<n; i++) {
+    struct perf_event_attr attr;
+    std::memset(&attr,0,sizeof(attr));
+    attr.size=sizeof(attr);
+    attr.type=PERF_TYPE_HARDWARE;
+    attr.config=config[i];
+    attr.exclude_kernel=1;
+    attr.exclude_hv=1;
+    attr.read_format=PERF_FORMAT_TOTAL_TIME_ENABLED|PERF_FORMAT_TOTAL_TIME_RUNNING;
+    fd[i]=syscall(__NR_perf_event_open,&attr,0,-1,-1,0);
+    if(fd[i]<0) {
+      error=std::string("perf_event_open failed for ")+getNames()[i]+": "+std::strerror(errno);
+      for(unsigned j=0; j<i; j++) close(fd[j]);
+      fd.fill(-1);
+      return;
+    }
+  }
+  available=true;
+#else
+  error="hardware counters are only available on Linux";
+#endif
+}
+
+PerfCounters::~PerfCounters() {
+#if defined(__linux__)
+  for(unsigned i=0; i<n; i++) if(fd[i]>=0) close(fd[i]);
+#endif
+}
+
+void PerfCounters::read(Values & values)const {
+  values.fill(0);
+#if defined(__linux__)
+  if(!available) return;
+  for(unsigned i=0; i<n; i++) {
+// value, time enabled, time running
+    unsigned long long buffer[3];
+    if(::read(fd[i],buffer,sizeof(buffer))!=sizeof(buffer)) continue;
+    if(buffer[2]==0) continue;
+    if(buffer[1]==buffer[2]) values[i]=buffer[0];
+    else values[i]=static_cast<unsigned long long>(static_cast<double>(buffer[0])*buffer[1]/buffer[2]);
+  }
+#endif
+}
+
+}
@@ -0,0 +1,75 @@
+/* +++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++
+   Copyright (c) 2020 The plumed team
+   (see the PEOPLE file at the root of the distribution for a list of names)
+
+   See http://www.plumed.org for more information.
+
+   This file is part of plumed, version 2.
+
+   plumed is free software: you can redistribute it and/or modify
+   it under the terms of the GNU Lesser General Public License as published by
+   the Free Software Foundation, either version 3 of the License, or
+   (at your option) any later version.
+
+   plumed is distributed in the hope that it will be useful,
+   but WITHOUT ANY WARRANTY; without even the implied warranty of
+   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+   GNU Lesser General Public License for more details.
+
+   You should have received a copy of the GNU Lesser General Public License
+   along with plumed.  If not, see <http://www.gnu.org/licenses/>.
++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++ */
+#ifndef __PLUMED_tools_PerfCounters_h
+#define __PLUMED_tools_PerfCounters_h
+
+#include <array>
+#include <string>
+
+namespace PLMD {
+
+/**
+\ingroup TOOLBOX
+Class reading hardware performance counters of the calling thread.
+
+Counters are read with the Linux perf_event_open system call and only count
+the thread that constructed the object. Other threads, such as OpenMP threads,
+are not included.
+If counters cannot be opened (e.g. because of the setting of
+/proc/sys/kernel/perf_event_paranoid, or on other operating systems)
+isAvailable() returns false and read() returns zeros, so that the calling code
+does not need to special case it.
+*/
+class PerfCounters {
+public:
+/// Number of counters
+  static constexpr unsigned n=4;
+/// Values of the counters: cycles, instructions, cache misses and branch misses
+  typedef std::array<unsigned long long,n> Values;
+/// Names of the counters
+  static const std::array<std::string,n> & getNames();
+private:
+/// File descriptors of the counters
+  std::array<int,n> fd;
+/// True if all counters could be opened
+  bool available=false;
+/// Reason why counters are not available
+  std::string error;
+public:
+/// Open the counters
+  PerfCounters();
+/// Close the counters
+  ~PerfCounters();
+  PerfCounters(const PerfCounters&) = delete;
+  PerfCounters & operator=(const PerfCounters&) = delete;
+/// Check if counters are available
+  bool isAvailable()const {return available;}
+/// Reason why counters are not available
+  const std::string & getError()const {return error;}
+/// Read the current value of the counters.
+/// Values are scaled to take into account multiplexing by the kernel.
+  void read(Values&)const;
+};
+
+}
+
+#endif
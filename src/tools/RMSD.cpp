@@ -26,9 +26,126 @@
 #include <cmath>
 #include <iostream>
 #include "Tools.h"
+#include "OpenMP.h"
 using namespace std;
 namespace PLMD {
 
+namespace {
+
+/// Adjugate of a 4x4 matrix, computed from its 2x2 minors.
+/// The determinant is returned.
+double adjugate4(const Tensor4d& a,Tensor4d& b) {
+  const double s0=a[0][0]*a[1][1]-a[1][0]*a[0][1];
+  const double s1=a[0][0]*a[1][2]-a[1][0]*a[0][2];
+  const double s2=a[0][0]*a[1][3]-a[1][0]*a[0][3];
+  const double s3=a[0][1]*a[1][2]-a[1][1]*a[0][2];
+  const double s4=a[0][1]*a[1][3]-a[1][1]*a[0][3];
+  const double s5=a[0][2]*a[1][3]-a[1][2]*a[0][3];
+  const double c5=a[2][2]*a[3][3]-a[3][2]*a[2][3];
+  const double c4=a[2][1]*a[3][3]-a[3][1]*a[2][3];
+  const double c3=a[2][1]*a[3][2]-a[3][1]*a[2][2];
+  const double c2=a[2][0]*a[3][3]-a[3][0]*a[2][3];
+  const double c1=a[2][0]*a[3][2]-a[3][0]*a[2][2];
+  const double c0=a[2][0]*a[3][1]-a[3][0]*a[2][1];
+  b[0][0]=+a[1][1]*c5-a[1][2]*c4+a[1][3]*c3;
+  b[0][1]=-a[0][1]*c5+a[0][2]*c4-a[0][3]*c3;
+  b[0][2]=+a[3][1]*s5-a[3][2]*s4+a[3][3]*s3;
+  b[0][3]=-a[2][1]*s5+a[2][2]*s4-a[2][3]*s3;
+  b[1][0]=-a[1][0]*c5+a[1][2]*c2-a[1][3]*c1;
+  b[1][1]=+a[0][0]*c5-a[0][2]*c2+a[0][3]*c1;
+  b[1][2]=-a[3][0]*s5+a[3][2]*s2-a[3][3]*s1;
+  b[1][3]=+a[2][0]*s5-a[2][2]*s2+a[2][3]*s1;
+  b[2][0]=+a[1][0]*c4-a[1][1]*c2+a[1][3]*c0;
+  b[2][1]=-a[0][0]*c4+a[0][1]*c2-a[0][3]*c0;
+  b[2][2]=+a[3][0]*s4-a[3][1]*s2+a[3][3]*s0;
+  b[2][3]=-a[2][0]*s4+a[2][1]*s2-a[2][3]*s0;
+  b[3][0]=-a[1][0]*c3+a[1][1]*c1-a[1][2]*c0;
+  b[3][1]=+a[0][0]*c3-a[0][1]*c1+a[0][2]*c0;
+  b[3][2]=-a[3][0]*s3+a[3][1]*s1-a[3][2]*s0;
+  b[3][3]=+a[2][0]*s3-a[2][1]*s1+a[2][2]*s0;
+  return s0*c5-s1*c4+s2*c3+s3*c2-s4*c1+s5*c0;
+}
+
+/// Lowest eigenvalue and eigenvector of the symmetric and traceless 4x4 matrix used to compute the optimal rotation.
+/// The eigenvalue is found with Newton iterations on the characteristic polynomial, as in the QCP method
+/// (Theobald, Acta Cryst. A 61, 478 (2005)), and the eigenvector from the adjugate of m-eval.
+/// If derivatives is true, pinv is set to the sum of v_l v_l^T/(eval-eval_l) over the other eigenvectors,
+/// which is what is needed to compute the derivatives of the eigenvector with perturbation theory.
+/// When the lowest eigenvalue is (nearly) degenerate diagMatSym() is used instead.
+template<bool derivatives>
+void lowestEigenpair(const Tensor4d& m,double& eval,Vector4d& q,Tensor4d& pinv) {
+// for a traceless matrix the characteristic polynomial is x^4 - tr(m^2)/2 x^2 - tr(m^3)/3 x + det(m)
+  const Tensor4d m2=matmul(m,m);
+  double tr2=0.0,tr3=0.0;
+  for(unsigned i=0; i<4; i++) {
+    tr2+=m2[i][i];
+    for(unsigned j=0; j<4; j++) tr3+=m2[i][j]*m[j][i];
+  }
+  Tensor4d adj;
+  const double c2=-0.5*tr2;
+  const double c1=-tr3/3.0;
+  const double c0=adjugate4(m,adj);
+// eigenvalues of a traceless 4x4 matrix satisfy x^2<=3/4 tr(m^2), so that Newton iterations started
+// from this bound converge monotonically to the lowest eigenvalue
+  const double scale=std::sqrt(tr2);
+  double x=-std::sqrt(0.75*tr2);
+  bool converged=false;
+  for(unsigned it=0; it<50 && scale>0.0; it++) {
+    const double x2=x*x;
+    const double p=(x2+c2)*x2+c1*x+c0;
+    const double dp=(4.0*x2+2.0*c2)*x+c1;
+    if(dp==0.0) break;
+    const double dx=p/dp;
+    x-=dx;
+    if(std::abs(dx)<=1e-14*scale) {
+      converged=true;
+      break;
+    }
+  }
+// the adjugate of m-x is proportional to q q^T, with a factor equal to the product of the gaps between x and the other eigenvalues
+  Tensor4d a(m);
+  for(unsigned i=0; i<4; i++) a[i][i]-=x;
+  adjugate4(a,adj);
+  unsigned imax=0;
+  for(unsigned i=1; i<4; i++) if(adj[i][i]>adj[imax][imax]) imax=i;
+  const double gaps=adj[0][0]+adj[1][1]+adj[2][2]+adj[3][3];
+  if(!converged || !(gaps>1e-6*scale*scale*scale)) {
+    if(derivatives) {
+      Vector4d eigenvals;
+      Tensor4d eigenvecs;
+      diagMatSym(m,eigenvals,eigenvecs);
+      eval=eigenvals[0];
+      q=Vector4d(eigenvecs[0][0],eigenvecs[0][1],eigenvecs[0][2],eigenvecs[0][3]);
+      pinv.zero();
+      for(unsigned l=1; l<4; l++) pinv+=Tensor4d(eigenvecs.getRow(l),eigenvecs.getRow(l))/(eigenvals[0]-eigenvals[l]);
+    } else {
+      VectorGeneric<1> eigenvals;
+      TensorGeneric<1,4> eigenvecs;
+      diagMatSym(m,eigenvals,eigenvecs);
+      eval=eigenvals[0];
+      q=Vector4d(eigenvecs[0][0],eigenvecs[0][1],eigenvecs[0][2],eigenvecs[0][3]);
+    }
+    return;
+  }
+  eval=x;
+  q=adj.getRow(imax);
+  q/=q.modulo();
+// same phase convention as diagMatSym()
+  for(unsigned j=0; j<4; j++) if(q[j]*q[j]>1e-14) {
+      if(q[j]<0.0) q*=-1.0;
+      break;
+    }
+  if(derivatives) {
+// (m-x+q q^T) has the same eigenvectors as m, with eigenvalue 1 for q
+    const Tensor4d qq(q,q);
+    Tensor4d inv;
+    const double det=adjugate4(a+qq,inv);
+    pinv=qq-inv/det;
+  }
+}
+
+}
+
 RMSD::RMSD() : alignmentMethod(SIMPLE),reference_center_is_calculated(false),reference_center_is_removed(false),positions_center_is_calculated(false),positions_center_is_removed(false) {}
 
 ///
@@ -488,18 +605,13 @@ double RMSD::optimalAlignment(const  std::vector<double>  & align,
 
   Tensor dq_drr01[4];
   if(!alEqDis) {
-    Vector4d eigenvals;
-    Tensor4d eigenvecs;
-    diagMatSym(m, eigenvals, eigenvecs );
-    dist=eigenvals[0]+rr00+rr11;
-    q=Vector4d(eigenvecs[0][0],eigenvecs[0][1],eigenvecs[0][2],eigenvecs[0][3]);
+    double eigenval;
+    Tensor4d pinv;
+    lowestEigenpair<true>(m, eigenval, q, pinv);
+    dist=eigenval+rr00+rr11;
     double dq_dm[4][4][4];
-    for(unsigned i=0; i<4; i++) for(unsigned j=0; j<4; j++) for(unsigned k=0; k<4; k++) {
-          double tmp=0.0;
 // perturbation theory for matrix m
-          for(unsigned l=1; l<4; l++) tmp+=eigenvecs[l][j]*eigenvecs[l][i]/(eigenvals[0]-eigenvals[l])*eigenvecs[0][k];
-          dq_dm[i][j][k]=tmp;
-        }
+    for(unsigned i=0; i<4; i++) for(unsigned j=0; j<4; j++) for(unsigned k=0; k<4; k++) dq_dm[i][j][k]=pinv[j][i]*q[k];
 // propagation to _drr01
     for(unsigned i=0; i<4; i++) {
       Tensor tmp;
@@ -509,11 +621,10 @@ double RMSD::optimalAlignment(const  std::vector<double>  & align,
       dq_drr01[i]=tmp;
     }
   } else {
-    VectorGeneric<1> eigenvals;
-    TensorGeneric<1,4> eigenvecs;
-    diagMatSym(m, eigenvals, eigenvecs );
-    dist=eigenvals[0]+rr00+rr11;
-    q=Vector4d(eigenvecs[0][0],eigenvecs[0][1],eigenvecs[0][2],eigenvecs[0][3]);
+    double eigenval;
+    Tensor4d pinv;
+    lowestEigenpair<false>(m, eigenval, q, pinv);
+    dist=eigenval+rr00+rr11;
   }
 
 
@@ -1025,15 +1136,12 @@ void RMSDCoreData::doCoreCalc(bool safe,bool alEqDis, bool only_rotation) {
 
   Tensor dq_drr01[4];
   if(!alEqDis or !only_rotation) {
-    diagMatSym(m, eigenvals, eigenvecs );
-    q=Vector4d(eigenvecs[0][0],eigenvecs[0][1],eigenvecs[0][2],eigenvecs[0][3]);
+    Tensor4d pinv;
+    lowestEigenpair<true>(m, eigenvals[0], q, pinv);
+    for(unsigned i=0; i<4; i++) eigenvecs[0][i]=q[i];
     double dq_dm[4][4][4];
-    for(unsigned i=0; i<4; i++) for(unsigned j=0; j<4; j++) for(unsigned k=0; k<4; k++) {
-          double tmp=0.0;
 // perturbation theory for matrix m
-          for(unsigned l=1; l<4; l++) tmp+=eigenvecs[l][j]*eigenvecs[l][i]/(eigenvals[0]-eigenvals[l])*eigenvecs[0][k];
-          dq_dm[i][j][k]=tmp;
-        }
+    for(unsigned i=0; i<4; i++) for(unsigned j=0; j<4; j++) for(unsigned k=0; k<4; k++) dq_dm[i][j][k]=pinv[j][i]*q[k];
 // propagation to _drr01
     for(unsigned i=0; i<4; i++) {
       Tensor tmp;
@@ -1043,12 +1151,9 @@ void RMSDCoreData::doCoreCalc(bool safe,bool alEqDis, bool only_rotation) {
       dq_drr01[i]=tmp;
     }
   } else {
-    TensorGeneric<1,4> here_eigenvecs;
-    VectorGeneric<1> here_eigenvals;
-    diagMatSym(m, here_eigenvals, here_eigenvecs );
-    for(unsigned i=0; i<4; i++) eigenvecs[0][i]=here_eigenvecs[0][i];
-    eigenvals[0]=here_eigenvals[0];
-    q=Vector4d(eigenvecs[0][0],eigenvecs[0][1],eigenvecs[0][2],eigenvecs[0][3]);
+    Tensor4d pinv;
+    lowestEigenpair<false>(m, eigenvals[0], q, pinv);
+    for(unsigned i=0; i<4; i++) eigenvecs[0][i]=q[i];
   }
 
 // This is the rotation matrix that brings reference to positions
@@ -1433,6 +1538,119 @@ const std::array<std::array<Tensor,3>,3> &  RMSDCoreData::getDRotationDRr01() co
 }
 
 
+MultiReferenceRMSD::MultiReferenceRMSD():
+  natoms(0)
+{
+}
+
+void MultiReferenceRMSD::clear() {
+  natoms=0;
+  align.clear();
+  references.clear();
+}
+
+bool MultiReferenceRMSD::add(RMSD& rmsd) {
+  if(rmsd.getMethod()!="OPTIMAL") return false;
+  const std::vector<double> a(rmsd.getAlign());
+  if(a!=rmsd.getDisplace()) return false;
+  if(references.empty()) {
+    natoms=a.size();
+    align=a;
+  } else if(a!=align) return false;
+  const std::vector<Vector> r(rmsd.getReference());
+  plumed_assert(r.size()==natoms);
+  references.insert(references.end(),r.begin(),r.end());
+  return true;
+}
+
+void MultiReferenceRMSD::calculate(const std::vector<Vector>& positions,const std::vector<unsigned>& frames,unsigned rank,unsigned stride,
+                                   std::vector<double>& distances,std::vector<Vector>& derivatives) {
+  const unsigned n=natoms;
+  plumed_assert(positions.size()==n);
+  plumed_assert(distances.size()>=frames.size());
+  plumed_assert(derivatives.size()>=frames.size()*n);
+
+// the center is computed and removed only once
+  Vector cpositions;
+  for(unsigned iat=0; iat<n; iat++) cpositions+=positions[iat]*align[iat];
+  centered.resize(n);
+  for(unsigned iat=0; iat<n; iat++) centered[iat]=positions[iat]-cpositions;
+
+  std::vector<unsigned> todo;
+  for(unsigned i=rank; i<frames.size(); i+=stride) {
+    plumed_assert(frames[i]<size());
+    todo.push_back(i);
+  }
+
+// frames are processed in groups, and atoms in blocks, so that a block of centered positions
+// is reused for all the frames of a group while it is in cache
+  const unsigned groupSize=16;
+  const unsigned blockSize=256;
+  const unsigned ngroups=(todo.size()+groupSize-1)/groupSize;
+  const Vector* c=centered.data();
+  const double* w=align.data();
+
+  #pragma omp parallel for num_threads(OpenMP::getNumThreads()) schedule(dynamic)
+  for(unsigned g=0; g<ngroups; g++) {
+    const unsigned first=g*groupSize;
+    const unsigned last=std::min(first+groupSize,unsigned(todo.size()));
+    Tensor rr01[groupSize];
+    for(unsigned ib=0; ib<n; ib+=blockSize) {
+      const unsigned iend=std::min(ib+blockSize,n);
+      for(unsigned k=first; k<last; k++) {
+        const Vector* r=&references[frames[todo[k]]*n];
+        Tensor t=rr01[k-first];
+        for(unsigned iat=ib; iat<iend; iat++) t+=Tensor(c[iat],r[iat])*w[iat];
+        rr01[k-first]=t;
+      }
+    }
+    for(unsigned k=first; k<last; k++) {
+      const unsigned i=todo[k];
+      const Vector* r=&references[frames[i]*n];
+      const Tensor & t(rr01[k-first]);
+      Tensor4d m;
+      m[0][0]=2.0*(-t[0][0]-t[1][1]-t[2][2]);
+      m[1][1]=2.0*(-t[0][0]+t[1][1]+t[2][2]);
+      m[2][2]=2.0*(+t[0][0]-t[1][1]+t[2][2]);
+      m[3][3]=2.0*(+t[0][0]+t[1][1]-t[2][2]);
+      m[0][1]=2.0*(-t[1][2]+t[2][1]);
+      m[0][2]=2.0*(+t[0][2]-t[2][0]);
+      m[0][3]=2.0*(-t[0][1]+t[1][0]);
+      m[1][2]=2.0*(-t[0][1]-t[1][0]);
+      m[1][3]=2.0*(-t[0][2]-t[2][0]);
+      m[2][3]=2.0*(-t[1][2]-t[2][1]);
+      m[1][0] = m[0][1];
+      m[2][0] = m[0][2];
+      m[2][1] = m[1][2];
+      m[3][0] = m[0][3];
+      m[3][1] = m[1][3];
+      m[3][2] = m[2][3];
+      double eigenval;
+      Vector4d q;
+      Tensor4d pinv;
+      lowestEigenpair<false>(m, eigenval, q, pinv);
+      Tensor rotation;
+      rotation[0][0]=q[0]*q[0]+q[1]*q[1]-q[2]*q[2]-q[3]*q[3];
+      rotation[1][1]=q[0]*q[0]-q[1]*q[1]+q[2]*q[2]-q[3]*q[3];
+      rotation[2][2]=q[0]*q[0]-q[1]*q[1]-q[2]*q[2]+q[3]*q[3];
+      rotation[0][1]=2*(+q[0]*q[3]+q[1]*q[2]);
+      rotation[0][2]=2*(-q[0]*q[2]+q[1]*q[3]);
+      rotation[1][2]=2*(+q[0]*q[1]+q[2]*q[3]);
+      rotation[1][0]=2*(-q[0]*q[3]+q[1]*q[2]);
+      rotation[2][0]=2*(+q[0]*q[2]+q[1]*q[3]);
+      rotation[2][1]=2*(-q[0]*q[1]+q[2]*q[3]);
+// as in RMSD::optimalAlignment<true,true>, the MSD is recomputed from the rotation matrix
+      double dist=0.0;
+      Vector* der=&derivatives[i*n];
+      for(unsigned iat=0; iat<n; iat++) {
+        Vector d(c[iat] - matmul(rotation,r[iat]));
+        der[iat]=2.0*w[iat]*d;
+        dist+=w[iat]*modulo2(d);
+      }
+      distances[i]=dist;
+    }
+  }
+}
 
 template double RMSD::optimalAlignment<true,true>(const  std::vector<double>  & align,
     const  std::vector<double>  & displace,
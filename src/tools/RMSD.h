@@ -368,6 +368,40 @@ public:
   const std::array<std::array<Tensor,3>,3> & getDRotationDRr01() const;
 };
 
+/// \ingroup TOOLBOX
+/// A class that computes the optimal-alignment MSD of a structure from many reference structures at once.
+/// The running structure is centered only once and the correlation matrices with all the references
+/// are accumulated in a single pass over the atoms. Atoms are processed in blocks, so that a block of
+/// centered positions stays in cache while the references, which are stored contiguously, are streamed.
+/// Different references are processed in parallel with OpenMP.
+/// The result is the same that would be obtained with RMSD::calculate() using TYPE=OPTIMAL and squared=true,
+/// apart from rounding: sums are computed in a different order, so results are not bitwise identical.
+/// All the references must have the same weights, and alignment and displacement weights must be equal.
+class MultiReferenceRMSD
+{
+  unsigned natoms;
+// Weights, shared by all references
+  std::vector<double> align;
+// References, one after the other
+  std::vector<Vector> references;
+// Centered positions
+  std::vector<Vector> centered;
+public:
+  MultiReferenceRMSD();
+/// Remove all the references
+  void clear();
+/// Number of references
+  unsigned size() const {return natoms>0?references.size()/natoms:0;}
+/// Add a reference taken from an RMSD object. If the reference cannot be treated together
+/// with the ones that are already stored, it is not added and false is returned
+  bool add(RMSD& rmsd);
+/// Compute the MSD from the references frames[i], for i=rank,rank+stride,rank+2*stride,etc.
+/// The MSD is stored in distances[i] and the derivatives in derivatives[i*natoms+j].
+/// Other elements are not modified, so that results can be summed over processes.
+  void calculate(const std::vector<Vector>& positions,const std::vector<unsigned>& frames,unsigned rank,unsigned stride,
+                 std::vector<double>& distances,std::vector<Vector>& derivatives);
+};
+
 }
 
 #endif
@@ -50,6 +50,37 @@ Stopwatch::~Stopwatch() {
   }
 }
 
+void Stopwatch::recordLaps(bool r) {
+  record=r;
+  for(auto & w : watches) {
+    w.second.record=r;
+    if(!r) w.second.laps.clear();
+  }
+}
+
+void Stopwatch::takeLaps(std::map<std::string,std::vector<long long int>> & laps) {
+  laps.clear();
+  for(auto & w : watches) {
+    auto & l(laps[w.first]);
+    l.swap(w.second.laps);
+  }
+}
+
+std::string Stopwatch::recordPerfCounters() {
+  if(!counters) counters.reset(new PerfCounters);
+  if(!counters->isAvailable()) {
+    std::string error=counters->getError();
+    counters.reset();
+    return error;
+  }
+  for(auto & w : watches) {
+    w.second.counters=counters.get();
+// watches that are already running start counting from now
+    counters->read(w.second.countersStart);
+  }
+  return "";
+}
+
 std::ostream& Stopwatch::log(std::ostream&os)const {
   char buffer[1000];
   buffer[0]=0;
@@ -69,6 +100,19 @@ std::ostream& Stopwatch::log(std::ostream&os)const {
     std::sprintf(buffer,"%12u %12.6f %12.6f %12.6f %12.6f\n", t.cycles, frac*t.total, frac*t.total/t.cycles, frac*t.min,frac*t.max);
     os<<buffer;
   }
+
+  if(counters) {
+    for(unsigned i=0; i<40; i++) os<<" ";
+    os<<"      Cycles Instructions          IPC Cache misses Branch misses\n";
+    for(const auto & name : names) {
+      const Watch&t(watches.find(name)->second);
+      const auto & c(t.countersTotal);
+      os<<name;
+      for(unsigned i=name.length(); i<40; i++) os<<" ";
+      std::sprintf(buffer,"%12llu %12llu %12.3f %12llu %12llu\n", c[0], c[1], (c[0]>0?double(c[1])/c[0]:0.0), c[2], c[3]);
+      os<<buffer;
+    }
+  }
   return os;
 }
 
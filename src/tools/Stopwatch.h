@@ -23,10 +23,14 @@
 #define __PLUMED_tools_Stopwatch_h
 
 #include "Exception.h"
+#include "PerfCounters.h"
 #include <string>
 #include <unordered_map>
+#include <map>
+#include <vector>
 #include <iosfwd>
 #include <chrono>
+#include <memory>
 
 namespace PLMD {
 
@@ -224,6 +228,16 @@ public:
     enum class State {started, stopped, paused};
 /// keep track of state
     State state = State::stopped;
+/// If true, the duration of each lap is stored in laps
+    bool record = false;
+/// Duration of the laps completed since they were last taken, in nanoseconds
+    std::vector<long long int> laps;
+/// Hardware counters, if they are recorded
+    const PerfCounters* counters = nullptr;
+/// Value of the hardware counters when Watch was started last time
+    PerfCounters::Values countersStart{};
+/// Total accumulated hardware counters
+    PerfCounters::Values countersTotal{};
 /// Allows access to internal data
     friend class Stopwatch;
   public:
@@ -249,6 +263,15 @@ private:
 /// Each watch is labeled with a string.
   std::unordered_map<std::string,Watch> watches;
 
+/// If true, newly created watches record the duration of each lap
+  bool record=false;
+
+/// Hardware counters recorded by all watches
+  std::unique_ptr<PerfCounters> counters;
+
+/// Get watch named "name", creating it if needed
+  Watch& getWatch(const std::string&name);
+
 /// Log over stream os.
   std::ostream& log(std::ostream& os)const;
 
@@ -280,6 +303,15 @@ public:
 /// pauses the watch. This allows Stopwatch to be started and paused in
 /// an exception safe manner.
   Handler startPause(const std::string&name=emptyString());
+/// Switch on or off recording of the duration of each lap of all watches
+  void recordLaps(bool);
+/// Move the duration (in nanoseconds) of the laps recorded since last call in laps.
+/// laps is indexed by watch name and contains all the watches, including those with no lap.
+  void takeLaps(std::map<std::string,std::vector<long long int>> & laps);
+/// Switch on recording of hardware counters for all watches.
+/// Returns an empty string on success, otherwise the reason why counters are not available.
+/// Counters are written in the log together with timings.
+  std::string recordPerfCounters();
 };
 
 inline
@@ -298,32 +330,42 @@ Stopwatch::Handler::~Handler() {
   }
 }
 
+inline
+Stopwatch::Watch& Stopwatch::getWatch(const std::string & name) {
+  auto it=watches.find(name);
+  if(it!=watches.end()) return it->second;
+  Watch & w(watches[name]);
+  w.record=record;
+  w.counters=counters.get();
+  return w;
+}
+
 inline
 Stopwatch& Stopwatch::start(const std::string & name) {
-  watches[name].start();
+  getWatch(name).start();
   return *this;
 }
 
 inline
 Stopwatch& Stopwatch::stop(const std::string & name) {
-  watches[name].stop();
+  getWatch(name).stop();
   return *this;
 }
 
 inline
 Stopwatch& Stopwatch::pause(const std::string & name) {
-  watches[name].pause();
+  getWatch(name).pause();
   return *this;
 }
 
 inline
 Stopwatch::Handler Stopwatch::startStop(const std::string&name) {
-  return watches[name].startStop();
+  return getWatch(name).startStop();
 }
 
 inline
 Stopwatch::Handler Stopwatch::startPause(const std::string&name) {
-  return watches[name].startPause();
+  return getWatch(name).startPause();
 }
 
 inline
@@ -363,6 +405,7 @@ Stopwatch::Watch & Stopwatch::Watch::start() {
   state=State::started;
   running++;
   lastStart=std::chrono::high_resolution_clock::now();
+  if(counters) counters->read(countersStart);
   return *this;
 }
 
@@ -374,6 +417,7 @@ Stopwatch::Watch & Stopwatch::Watch::stop() {
   total+=lap;
   if(lap>max)max=lap;
   if(min>lap || cycles==1)min=lap;
+  if(record) laps.push_back(lap);
   lap=0;
   return *this;
 }
@@ -391,6 +435,11 @@ Stopwatch::Watch & Stopwatch::Watch::pause() {
   if(running!=0) return *this;
   auto t=std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::high_resolution_clock::now()-lastStart);
   lap+=t.count();
+  if(counters) {
+    PerfCounters::Values now;
+    counters->read(now);
+    for(unsigned i=0; i<PerfCounters::n; i++) countersTotal[i]+=now[i]-countersStart[i];
+  }
   return *this;
 }
 
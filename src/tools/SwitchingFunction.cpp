@@ -24,6 +24,7 @@
 #include "Keywords.h"
 #include "OpenMP.h"
 #include <vector>
+#include <set>
 #include <limits>
 
 #define PI 3.14159265358979323846
@@ -265,36 +266,24 @@ void SwitchingFunction::set(const std::string & definition,std::string& errormsg
     Tools::parse(data,"FUNC",func);
     lepton::ParsedExpression pe=lepton::Parser::parse(func).optimize(lepton::Constants());
     lepton_func=func;
+    const std::set<std::string> vars(pe.createCompiledExpression().getVariables());
+    if(!vars.count("x") && vars.count("x2")) leptonx2=true;
+    std::string arg="x";
+    if(leptonx2) arg="x2";
+// the function and its derivative are compiled together, so that common subexpressions are computed once
+    std::vector<lepton::ParsedExpression> pes;
+    pes.push_back(pe);
+    pes.push_back(lepton::Parser::parse(func).differentiate(arg).optimize(lepton::Constants()));
     expression.resize(OpenMP::getNumThreads());
-    for(auto & e : expression) e=pe.createCompiledExpression();
+    for(auto & e : expression) e=lepton::CompiledExpression(pes);
     lepton_ref.resize(expression.size());
     for(unsigned t=0; t<lepton_ref.size(); t++) {
       try {
-        lepton_ref[t]=&const_cast<lepton::CompiledExpression*>(&expression[t])->getVariableReference("x");
+        lepton_ref[t]=&const_cast<lepton::CompiledExpression*>(&expression[t])->getVariableReference(arg);
       } catch(const PLMD::lepton::Exception& exc) {
-        try {
-          lepton_ref[t]=&const_cast<lepton::CompiledExpression*>(&expression[t])->getVariableReference("x2");
-          leptonx2=true;
-        } catch(const PLMD::lepton::Exception& exc) {
 // this is necessary since in some cases lepton things a variable is not present even though it is present
 // e.g. func=0*x
-          lepton_ref[t]=nullptr;
-        }
-      }
-    }
-    std::string arg="x";
-    if(leptonx2) arg="x2";
-    lepton::ParsedExpression ped=lepton::Parser::parse(func).differentiate(arg).optimize(lepton::Constants());
-    expression_deriv.resize(OpenMP::getNumThreads());
-    for(auto & e : expression_deriv) e=ped.createCompiledExpression();
-    lepton_ref_deriv.resize(expression_deriv.size());
-    for(unsigned t=0; t<lepton_ref_deriv.size(); t++) {
-      try {
-        lepton_ref_deriv[t]=&const_cast<lepton::CompiledExpression*>(&expression_deriv[t])->getVariableReference(arg);
-      } catch(const PLMD::lepton::Exception& exc) {
-// this is necessary since in some cases lepton things a variable is not present even though it is present
-// e.g. func=3*x
-        lepton_ref_deriv[t]=nullptr;
+        lepton_ref[t]=nullptr;
       }
     }
 
@@ -404,9 +393,8 @@ double SwitchingFunction::calculateSqr(double distance2,double&dfunc)const {
     const double rdist_2 = distance2*invr0_2;
     plumed_assert(t<expression.size());
     if(lepton_ref[t]) *lepton_ref[t]=rdist_2;
-    if(lepton_ref_deriv[t]) *lepton_ref_deriv[t]=rdist_2;
     double result=expression[t].evaluate();
-    dfunc=expression_deriv[t].evaluate();
+    dfunc=expression[t].getResult(1);
 // chain rule:
     dfunc*=2*invr0_2;
 // stretch:
@@ -419,6 +407,233 @@ double SwitchingFunction::calculateSqr(double distance2,double&dfunc)const {
   }
 }
 
+namespace {
+/// Same as Tools::fastpow(base,exp), with the exponent known at compile time.
+/// The multiplications are done in the same order, so that results are identical.
+template<int exp>
+struct FixedPow {
+  template<class T>
+  static T eval(T result,T base) {
+    return FixedPow<(exp>>1)>::eval(exp&1 ? result*base : result, base*base);
+  }
+};
+template<>
+struct FixedPow<0> {
+  template<class T>
+  static T eval(T result,T) {
+    return result;
+  }
+};
+
+/// Switching functions of the scaled distance used in batched calculations.
+/// They are templates so that they can be used both in single and double precision.
+struct ExponentialSwitch {
+  template<class T>
+  T operator()(T rdist,T&df)const {
+    const T res=std::exp(-rdist);
+    df=-res;
+    return res;
+  }
+};
+struct GaussianSwitch {
+  template<class T>
+  T operator()(T rdist,T&df)const {
+    const T res=std::exp(T(-0.5)*rdist*rdist);
+    df=-rdist*res;
+    return res;
+  }
+};
+struct CubicSwitch {
+  template<class T>
+  T operator()(T rdist,T&df)const {
+    const T tmp1=rdist-1, tmp2=(1+2*rdist);
+    df=2*tmp1*tmp2 + 2*tmp1*tmp1;
+    return tmp1*tmp1*tmp2;
+  }
+};
+struct TanhSwitch {
+  template<class T>
+  T operator()(T rdist,T&df)const {
+    const T tmp1=std::tanh(rdist);
+    df=-(1-tmp1*tmp1);
+    return T(1.0) - tmp1;
+  }
+};
+}
+
+template<int N,class T>
+void SwitchingFunction::do_fastrational(unsigned n,const T* distance2,T* result,T* dfunc)const {
+  const int nn2=N+1;
+  const T invr0_2t=invr0_2;
+// dmax_2 might not be representable in T (e.g. the default value in single precision)
+  const T dmax_2t=(dmax_2<std::numeric_limits<T>::max() ? T(dmax_2) : std::numeric_limits<T>::infinity());
+  const T stretcht=stretch;
+  const T shiftt=shift;
+  #pragma omp simd
+  for(unsigned i=0; i<n; ++i) {
+    const T rdist_2=distance2[i]*invr0_2t;
+    const T rNdist=FixedPow<N>::eval(T(1.0),rdist_2);
+    const T iden=T(1.0)/(1+rNdist*rdist_2);
+    T df=-nn2*rNdist*iden*iden;
+    df*=2*invr0_2t;
+    const bool out=distance2[i]>dmax_2t;
+    result[i]=(out ? T(0.0) : iden*stretcht+shiftt);
+    dfunc[i]=(out ? T(0.0) : df*stretcht);
+  }
+}
+
+template<class T,class F>
+void SwitchingFunction::do_batch(unsigned n,const T* distance2,T* result,T* dfunc,F f)const {
+  const T d0t=d0;
+  const T invr0t=invr0;
+// dmax might not be representable in T (e.g. the default value in single precision)
+  const T dmaxt=(dmax<std::numeric_limits<T>::max() ? T(dmax) : std::numeric_limits<T>::infinity());
+  const T stretcht=stretch;
+  const T shiftt=shift;
+  #pragma omp simd
+  for(unsigned i=0; i<n; ++i) {
+    const T distance=std::sqrt(distance2[i]);
+    const T rdist=(distance-d0t)*invr0t;
+    T df;
+    T res=f(rdist,df);
+    df*=invr0t;
+    df/=distance;
+    if(rdist<=0.) {
+      res=1.;
+      df=0.0;
+    }
+    const bool out=distance>dmaxt;
+    result[i]=(out ? T(0.0) : res*stretcht+shiftt);
+    dfunc[i]=(out ? T(0.0) : df*stretcht);
+  }
+}
+
+template<class T>
+bool SwitchingFunction::do_simple_batch(unsigned n,const T* distance2,T* result,T* dfunc)const {
+  if(fastrational && 2*(nn/2)==mm/2 && nn/2>=1 && nn/2<=8) {
+// the most common case (e.g. NN=6 MM=12) is specialized on the exponent
+    switch(nn/2) {
+    case 1: do_fastrational<0>(n,distance2,result,dfunc); break;
+    case 2: do_fastrational<1>(n,distance2,result,dfunc); break;
+    case 3: do_fastrational<2>(n,distance2,result,dfunc); break;
+    case 4: do_fastrational<3>(n,distance2,result,dfunc); break;
+    case 5: do_fastrational<4>(n,distance2,result,dfunc); break;
+    case 6: do_fastrational<5>(n,distance2,result,dfunc); break;
+    case 7: do_fastrational<6>(n,distance2,result,dfunc); break;
+    case 8: do_fastrational<7>(n,distance2,result,dfunc); break;
+    }
+  } else if(type==exponential && !fastrational && !leptonx2) {
+    do_batch(n,distance2,result,dfunc,ExponentialSwitch());
+  } else if(type==gaussian && !fastrational && !leptonx2) {
+    do_batch(n,distance2,result,dfunc,GaussianSwitch());
+  } else if(type==cubic && !fastrational && !leptonx2) {
+    do_batch(n,distance2,result,dfunc,CubicSwitch());
+  } else if(type==tanh && !fastrational && !leptonx2) {
+    do_batch(n,distance2,result,dfunc,TanhSwitch());
+  } else {
+    return false;
+  }
+  return true;
+}
+
+template<class T>
+void SwitchingFunction::do_lepton_batch(unsigned n,const T* distance2,T* result,T* dfunc)const {
+  const unsigned t=OpenMP::getThreadNum();
+  plumed_assert(t<expression.size());
+  const unsigned chunk=64;
+  double x[chunk],f[chunk],df[chunk];
+// the argument is read from x, other variables (if any) are zero as in calculate()
+  const double zero=0.0;
+  const std::string arg=(leptonx2?"x2":"x");
+  std::vector<const double*> vars;
+  std::vector<int> strides;
+  for(const auto & v : expression[t].getVariables()) {
+    vars.push_back(v==arg?x:&zero);
+    strides.push_back(v==arg?1:0);
+  }
+// the function and its derivative are computed together
+  const std::vector<double*> results {f,df};
+  for(unsigned start=0; start<n; start+=chunk) {
+    const unsigned m=std::min(chunk,n-start);
+    for(unsigned i=0; i<m; ++i) {
+      const double d2=distance2[start+i];
+      x[i]=(leptonx2 ? d2*invr0_2 : (std::sqrt(d2)-d0)*invr0);
+    }
+    expression[t].evaluate(m,vars,strides,results);
+// same operations as in calculateSqr() and calculate()
+    for(unsigned i=0; i<m; ++i) {
+      const double d2=distance2[start+i];
+      double res=f[i];
+      double dres=df[i];
+      if(leptonx2) {
+        if(d2>dmax_2) {
+          result[start+i]=0.0;
+          dfunc[start+i]=0.0;
+          continue;
+        }
+        dres*=2*invr0_2;
+      } else {
+        const double distance=std::sqrt(d2);
+        if(distance>dmax) {
+          result[start+i]=0.0;
+          dfunc[start+i]=0.0;
+          continue;
+        }
+        if(x[i]<=0.) {
+          res=1.;
+          dres=0.0;
+        } else {
+          dres*=invr0;
+          dres/=distance;
+        }
+      }
+      result[start+i]=res*stretch+shift;
+      dfunc[start+i]=dres*stretch;
+    }
+  }
+}
+
+void SwitchingFunction::calculateSqr(unsigned n,const double* distance2,double* result,double* dfunc)const {
+  plumed_massert(init,"you are trying to use an unset SwitchingFunction");
+  if(do_simple_batch(n,distance2,result,dfunc)) {
+    return;
+  } else if(fastrational) {
+    const int nn2=nn/2;
+    const int mm2=mm/2;
+    for(unsigned i=0; i<n; ++i) {
+      const double rdist_2=distance2[i]*invr0_2;
+      double df;
+      const double res=do_rational(rdist_2,df,nn2,mm2);
+      df*=2*invr0_2;
+      const bool out=distance2[i]>dmax_2;
+      result[i]=(out ? 0.0 : res*stretch+shift);
+      dfunc[i]=(out ? 0.0 : df*stretch);
+    }
+  } else if(type==rational && !leptonx2) {
+    do_batch(n,distance2,result,dfunc,[this](double rdist,double&df) {return do_rational(rdist,df,nn,mm);});
+  } else if(type==leptontype) {
+    do_lepton_batch(n,distance2,result,dfunc);
+  } else {
+// other functions are computed one by one
+    for(unsigned i=0; i<n; ++i) result[i]=calculateSqr(distance2[i],dfunc[i]);
+  }
+}
+
+void SwitchingFunction::calculateSqr(unsigned n,const float* distance2,float* result,float* dfunc)const {
+  plumed_massert(init,"you are trying to use an unset SwitchingFunction");
+  if(do_simple_batch(n,distance2,result,dfunc)) return;
+  if(type==leptontype) {
+    do_lepton_batch(n,distance2,result,dfunc);
+    return;
+  }
+// other functions are computed in double precision
+  for(unsigned i=0; i<n; ++i) {
+    double df;
+    result[i]=calculateSqr(double(distance2[i]),df);
+    dfunc[i]=df;
+  }
+}
+
 double SwitchingFunction::calculate(double distance,double&dfunc)const {
   plumed_massert(init,"you are trying to use an unset SwitchingFunction");
   if(distance>dmax) {
@@ -482,9 +697,8 @@ double SwitchingFunction::calculate(double distance,double&dfunc)const {
       const unsigned t=OpenMP::getThreadNum();
       plumed_assert(t<expression.size());
       if(lepton_ref[t]) *lepton_ref[t]=rdist;
-      if(lepton_ref_deriv[t]) *lepton_ref_deriv[t]=rdist;
       result=expression[t].evaluate();
-      dfunc=expression_deriv[t].evaluate();
+      dfunc=expression[t].getResult(1);
     } else plumed_merror("Unknown switching function type");
 // this is for the chain rule:
     dfunc*=invr0;
@@ -73,16 +73,25 @@ class SwitchingFunction {
 /// Low-level tool to compute rational functions.
 /// It is separated since it is called both by calculate() and calculateSqr()
   double do_rational(double rdist,double&dfunc,int nn,int mm)const;
+/// Batched version of the fast rational function, with exponent nn=2*(N+1) and mm=2*nn
+  template<int N,class T>
+  void do_fastrational(unsigned n,const T* distance2,T* result,T* dfunc)const;
+/// Batched version of calculate() for functions of the distance, with the function body given by f
+  template<class T,class F>
+  void do_batch(unsigned n,const T* distance2,T* result,T* dfunc,F f)const;
+/// Batched calculation of the functions that can be computed in any precision.
+/// Returns false if the function is not one of them
+  template<class T>
+  bool do_simple_batch(unsigned n,const T* distance2,T* result,T* dfunc)const;
+/// Batched calculation of lepton functions, evaluating the expressions on arrays of distances
+  template<class T>
+  void do_lepton_batch(unsigned n,const T* distance2,T* result,T* dfunc)const;
 /// Function for lepton;
   std::string lepton_func;
-/// Lepton expression.
+/// Lepton expression, computing the function and its derivative.
 /// \warning Since lepton::CompiledExpression is mutable, a vector is necessary for multithreading!
   std::vector<lepton::CompiledExpression> expression;
-/// Lepton expression for derivative
-/// \warning Since lepton::CompiledExpression is mutable, a vector is necessary for multithreading!
-  std::vector<lepton::CompiledExpression> expression_deriv;
   std::vector<double*> lepton_ref;
-  std::vector<double*> lepton_ref_deriv;
 /// Set to true for fast rational functions (depending on x**2 only)
   bool fastrational=false;
 /// Set to true if lepton only uses x2
@@ -110,6 +119,15 @@ public:
 /// The advantage is that in some case the expensive square root can be avoided
 /// (namely for rational functions, if nn and mm are even and d0 is zero)
   double calculateSqr(double distance2,double&dfunc)const;
+/// Compute the switching function on an array of n squared distances.
+/// Equivalent to calling calculateSqr() on each element, storing s in result and df in dfunc.
+/// The type of function is dispatched once per call, so that the loop over the
+/// distances can be vectorized.
+  void calculateSqr(unsigned n,const double* distance2,double* result,double* dfunc)const;
+/// Same as calculateSqr() on an array of distances, in single precision.
+/// Exponential, gaussian, cubic, tanh and rational functions with even NN, MM=2*NN and D_0=0 are computed
+/// in single precision, the other ones are computed in double precision and then converted.
+  void calculateSqr(unsigned n,const float* distance2,float* result,float* dfunc)const;
 /// Returns d0
   double get_d0() const;
 /// Returns r0
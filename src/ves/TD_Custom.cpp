@@ -27,6 +27,7 @@
 #include "tools/Grid.h"
 
 #include "lepton/Lepton.h"
+#include <algorithm>
 
 
 namespace PLMD {
@@ -119,11 +120,6 @@ private:
   //
   lepton::CompiledExpression expression;
   //
-  std::vector<double*> cv_var_lepton_refs_;
-  double* kbt_var_lepton_ref_;
-  double* beta_var_lepton_ref_;
-  double* fes_var_lepton_ref_;
-  //
   std::vector<unsigned int> cv_var_idx_;
   std::vector<std::string> cv_var_str_;
   //
@@ -156,11 +152,6 @@ void TD_Custom::registerKeywords(Keywords& keys) {
 
 TD_Custom::TD_Custom(const ActionOptions& ao):
   PLUMED_VES_TARGETDISTRIBUTION_INIT(ao),
-//
-  cv_var_lepton_refs_(0,nullptr),
-  kbt_var_lepton_ref_(nullptr),
-  beta_var_lepton_ref_(nullptr),
-  fes_var_lepton_ref_(nullptr),
 //
   cv_var_idx_(0),
   cv_var_str_(0),
@@ -211,29 +202,9 @@ TD_Custom::TD_Custom(const ActionOptions& ao):
   //
   std::sort(cv_var_idx_.begin(),cv_var_idx_.end());
   cv_var_str_.resize(cv_var_idx_.size());
-  cv_var_lepton_refs_.resize(cv_var_str_.size());
   for(unsigned int j=0; j<cv_var_idx_.size(); j++) {
     std::string str1; Tools::convert(cv_var_idx_[j]+1,str1);
     cv_var_str_[j] = cv_var_prefix_str_+str1;
-    try {
-      cv_var_lepton_refs_[j] = &expression.getVariableReference(cv_var_str_[j]);
-    } catch(PLMD::lepton::Exception& exc) {}
-  }
-
-  if(use_kbt_) {
-    try {
-      kbt_var_lepton_ref_ = &expression.getVariableReference(kbt_var_str_);
-    } catch(PLMD::lepton::Exception& exc) {}
-  }
-  if(use_beta_) {
-    try {
-      beta_var_lepton_ref_ = &expression.getVariableReference(beta_var_str_);
-    } catch(PLMD::lepton::Exception& exc) {}
-  }
-  if(use_fes_) {
-    try {
-      fes_var_lepton_ref_ = &expression.getVariableReference(fes_var_str_);
-    } catch(PLMD::lepton::Exception& exc) {}
   }
 
 }
@@ -256,25 +227,45 @@ void TD_Custom::updateGrid() {
   if(use_fes_) {
     plumed_massert(getFesGridPntr()!=NULL,"the FES grid has to be linked to the free energy in the target distribution");
   }
-  if(use_kbt_) {
-    if(kbt_var_lepton_ref_) {*kbt_var_lepton_ref_= 1.0/getBeta();}
+  double kbt = 0.0;
+  double beta = 0.0;
+  if(use_kbt_) {kbt = 1.0/getBeta();}
+  if(use_beta_) {beta = getBeta();}
+  //
+  // the function is evaluated on all the grid points at once
+  const Grid::index_t ngrid = targetDistGrid().getSize();
+  std::vector<std::vector<double> > cv_values(cv_var_str_.size(),std::vector<double>(ngrid));
+  for(Grid::index_t l=0; l<ngrid; l++) {
+    std::vector<double> point = targetDistGrid().getPoint(l);
+    for(unsigned int k=0; k<cv_var_str_.size() ; k++) {
+      cv_values[k][l] = point[cv_var_idx_[k]];
+    }
+  }
+  std::vector<double> fes_values;
+  if(use_fes_) {
+    fes_values.resize(ngrid);
+    for(Grid::index_t l=0; l<ngrid; l++) {fes_values[l] = getFesGridPntr()->getValue(l);}
   }
-  if(use_beta_) {
-    if(beta_var_lepton_ref_) {*beta_var_lepton_ref_= getBeta();}
+  std::vector<const double*> variables;
+  std::vector<int> strides;
+  for(auto &p: expression.getVariables()) {
+    if(p==kbt_var_str_) {variables.push_back(&kbt); strides.push_back(0);}
+    else if(p==beta_var_str_) {variables.push_back(&beta); strides.push_back(0);}
+    else if(p==fes_var_str_) {variables.push_back(fes_values.data()); strides.push_back(1);}
+    else {
+      unsigned int k = std::find(cv_var_str_.begin(),cv_var_str_.end(),p)-cv_var_str_.begin();
+      plumed_assert(k<cv_var_str_.size());
+      variables.push_back(cv_values[k].data()); strides.push_back(1);
+    }
   }
+  std::vector<double> values(ngrid);
+  expression.evaluate(ngrid,variables,strides,values.data());
   //
   std::vector<double> integration_weights = GridIntegrationWeights::getIntegrationWeights(getTargetDistGridPntr());
   double norm = 0.0;
   //
-  for(Grid::index_t l=0; l<targetDistGrid().getSize(); l++) {
-    std::vector<double> point = targetDistGrid().getPoint(l);
-    for(unsigned int k=0; k<cv_var_str_.size() ; k++) {
-      if(cv_var_lepton_refs_[k]) {*cv_var_lepton_refs_[k] = point[cv_var_idx_[k]];}
-    }
-    if(use_fes_) {
-      if(fes_var_lepton_ref_) {*fes_var_lepton_ref_ = getFesGridPntr()->getValue(l);}
-    }
-    double value = expression.evaluate();
+  for(Grid::index_t l=0; l<ngrid; l++) {
+    double value = values[l];
 
     if(value<0.0 && !isTargetDistGridShiftedToZero()) {plumed_merror(getName()+": The target distribution function gives negative values. You should change the definition of the function used for the target distribution to avoid this. You can also use the SHIFT_TO_ZERO keyword to avoid this problem.");}
     targetDistGrid().setValue(l,value);
@@ -30,6 +30,7 @@
 #include "StoreDataVessel.h"
 #include "tools/OpenMP.h"
 #include "tools/Stopwatch.h"
+#include <algorithm>
 
 using namespace std;
 namespace PLMD {
@@ -279,16 +280,35 @@ void ActionWithVessel::runAllTasks() {
   unsigned bsize=0, bufsize=getSizeOfBuffer( bsize );
   // Clear buffer
   buffer.assign( buffer.size(), 0.0 );
+  // Check if the stored derivatives can be summed over the nodes by communicating only those in use,
+  // which is possible when each stored value is computed by a single task
+  bool storeder=( mydata && !lowmem && !noderiv );
+  bool sparse=( !serial && stride>1 && storeder && getFullNumberOfTasks()==mydata->getNumberOfStoredValues() );
+  // The numbers of stored derivatives are set again at each step, so that old ones are not summed over the nodes.
+  // When the whole list is summed, the old indices of the derivatives are also cleared
+  if( storeder && stride>1 && !sparse ) std::fill( der_list.begin(), der_list.end(), 0 );
+  else if( storeder ) std::fill( der_list.begin(), der_list.begin()+mydata->getNumberOfStoredValues(), 0 );
   // Switch off calculation of derivatives in main loop
   if( dertime_can_be_off ) dertime=false;
 
+  // Set up the workspaces of the threads, which are kept between calls
+  unsigned nquantities=getNumberOfQuantities(), nderivatives=getNumberOfDerivatives();
+  if( omp_myvals.size()<nt ) {
+    omp_myvals.resize( nt, MultiValue( nquantities, nderivatives ) );
+    omp_bvals.resize( nt, MultiValue( nquantities, nderivatives ) );
+  }
+  if( omp_buffer.size()<nt ) omp_buffer.resize( nt );
+  for(unsigned t=1; t<nt; ++t) if( omp_buffer[t].size()!=bufsize ) omp_buffer[t].assign( bufsize, 0.0 );
+
   if(timers) stopwatch.start("2 Loop over tasks");
   #pragma omp parallel num_threads(nt)
   {
-    std::vector<double> omp_buffer;
-    if( nt>1 ) omp_buffer.resize( bufsize, 0.0 );
-    MultiValue myvals( getNumberOfQuantities(), getNumberOfDerivatives() );
-    MultiValue bvals( getNumberOfQuantities(), getNumberOfDerivatives() );
+    // The first thread accumulates directly in the buffer
+    unsigned t=OpenMP::getThreadNum();
+    std::vector<double>& mybuffer( t==0 ? buffer : omp_buffer[t] );
+    MultiValue& myvals( omp_myvals[t] ); MultiValue& bvals( omp_bvals[t] );
+    if( myvals.getNumberOfValues()!=nquantities || myvals.getNumberOfDerivatives()!=nderivatives ) myvals.resize( nquantities, nderivatives );
+    if( bvals.getNumberOfValues()!=nquantities || bvals.getNumberOfDerivatives()!=nderivatives ) bvals.resize( nquantities, nderivatives );
     myvals.clearAll(); bvals.clearAll();
 
     #pragma omp for nowait schedule(dynamic)
@@ -308,17 +328,19 @@ void ActionWithVessel::runAllTasks() {
       // Now calculate all the functions
       // If the contribution of this quantity is very small at neighbour list time ignore it
       // untill next neighbour list time
-      if( nt>1 ) {
-        calculateAllVessels( indexOfTaskInFullList[i], myvals, bvals, omp_buffer, der_list );
-      } else {
-        calculateAllVessels( indexOfTaskInFullList[i], myvals, bvals, buffer, der_list );
-      }
+      calculateAllVessels( indexOfTaskInFullList[i], myvals, bvals, mybuffer, der_list );
 
       // Clear the value
       myvals.clearAll();
     }
-    #pragma omp critical
-    if(nt>1) for(unsigned i=0; i<bufsize; ++i) buffer[i]+=omp_buffer[i];
+  }
+  // Sum the buffers of the other threads in parallel, each thread taking care of a
+  // different part of the buffer. The buffers of the threads are cleared for the next call
+  if( nt>1 ) {
+    #pragma omp parallel for num_threads(nt) schedule(static)
+    for(unsigned i=0; i<bufsize; ++i) {
+      for(unsigned t=1; t<nt; ++t) { buffer[i]+=omp_buffer[t][i]; omp_buffer[t][i]=0.0; }
+    }
   }
   if(timers) stopwatch.stop("2 Loop over tasks");
   // Turn back on derivative calculation
@@ -326,10 +348,16 @@ void ActionWithVessel::runAllTasks() {
 
   if(timers) stopwatch.start("3 MPI gather");
   // MPI Gather everything
-  if( !serial && buffer.size()>0 ) comm.Sum( buffer );
+  if( sparse ) {
+    unsigned dstart=mydata->bufstart, dend=dstart+mydata->bufsize;
+    if( dstart>0 ) comm.Sum( &buffer[0], dstart );
+    if( dend<bufsize ) comm.Sum( &buffer[dend], bufsize-dend );
+    mydata->sumOverNodes( comm, buffer, der_list );
+  } else if( !serial && buffer.size()>0 ) comm.Sum( buffer );
   // MPI Gather index stores
-  if( mydata && !lowmem && !noderiv ) {
-    comm.Sum( der_list ); mydata->setActiveValsAndDerivatives( der_list );
+  if( storeder ) {
+    if( !sparse ) comm.Sum( der_list );
+    mydata->setActiveValsAndDerivatives( der_list );
   }
   // Update the elements that are makign contributions to the sum here
   // this causes problems if we do it in prepare
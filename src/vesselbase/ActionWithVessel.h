@@ -85,6 +85,11 @@ private:
   std::vector<unsigned> der_list;
 /// The buffer that we use (we keep a copy here to avoid resizing)
   std::vector<double> buffer;
+/// The buffers used by the OpenMP threads other than the first one (we keep a copy here to avoid resizing).
+/// These are always zero outside runAllTasks
+  std::vector<std::vector<double> > omp_buffer;
+/// The MultiValues used by each OpenMP thread (we keep a copy here to avoid resizing)
+  std::vector<MultiValue> omp_myvals, omp_bvals;
 /// Do we want to output information on the timings of different parts of the calculation
   bool timers;
   ForwardDecl<Stopwatch> stopwatch_fwd;
@@ -20,6 +20,7 @@
    along with plumed.  If not, see <http://www.gnu.org/licenses/>.
 +++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++ */
 #include "StoreDataVessel.h"
+#include "tools/Communicator.h"
 
 namespace PLMD {
 namespace vesselbase {
@@ -167,6 +168,45 @@ void StoreDataVessel::setActiveValsAndDerivatives( const std::vector<unsigned>&
   }
 }
 
+void StoreDataVessel::sumOverNodes( Communicator& comm, std::vector<double>& buffer, std::vector<unsigned>& der_index ) {
+  plumed_dbg_assert( !getAction()->lowmem && getAction()->derivativesAreRequired() );
+  unsigned nstored=getNumberOfStoredValues();
+  // The elements computed on this node are those that have derivatives here
+  if( sum_nder.size()<nstored ) sum_nder.resize( nstored );
+  std::copy( der_index.begin(), der_index.begin()+nstored, sum_nder.begin() );
+  comm.Sum( &der_index[0], nstored );
+
+  // Pack the values, the derivatives in use and their indices
+  unsigned nder=0; for(unsigned i=0; i<nstored; ++i) nder+=der_index[i];
+  unsigned nvalues=vecsize*(nstored+nder);
+  if( sum_indices.size()<nder ) sum_indices.resize( nder );
+  if( sum_values.size()<nvalues ) sum_values.resize( nvalues );
+  std::fill( sum_indices.begin(), sum_indices.begin()+nder, 0 );
+  unsigned k=0, l=0;
+  for(unsigned i=0; i<nstored; ++i) {
+    unsigned kder = nstored + i*( nspace - 1 );
+    if( sum_nder[i]>0 ) for(unsigned j=0; j<der_index[i]; ++j) sum_indices[k+j]=der_index[kder+j];
+    k+=der_index[i];
+    for(unsigned icomp=0; icomp<vecsize; ++icomp) {
+      unsigned ibuf = bufstart + i*( vecsize*nspace ) + icomp*nspace;
+      for(unsigned j=0; j<=der_index[i]; ++j) { sum_values[l]=buffer[ibuf+j]; l++; }
+    }
+  }
+  if( nder>0 ) comm.Sum( &sum_indices[0], nder );
+  if( nvalues>0 ) comm.Sum( &sum_values[0], nvalues );
+
+  // And unpack them
+  k=0; l=0;
+  for(unsigned i=0; i<nstored; ++i) {
+    unsigned kder = nstored + i*( nspace - 1 );
+    for(unsigned j=0; j<der_index[i]; ++j) { der_index[kder+j]=sum_indices[k]; k++; }
+    for(unsigned icomp=0; icomp<vecsize; ++icomp) {
+      unsigned ibuf = bufstart + i*( vecsize*nspace ) + icomp*nspace;
+      for(unsigned j=0; j<=der_index[i]; ++j) { buffer[ibuf+j]=sum_values[l]; l++; }
+    }
+  }
+}
+
 void StoreDataVessel::resizeTemporyMultiValues( const unsigned& nvals ) {
   for(unsigned i=0; i<nvals; ++i) my_tmp_vals.push_back( MultiValue(0,0) );
 }
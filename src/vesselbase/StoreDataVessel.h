@@ -28,6 +28,9 @@
 #include "Vessel.h"
 
 namespace PLMD {
+
+class Communicator;
+
 namespace vesselbase {
 
 /**
@@ -62,6 +65,10 @@ private:
 /// lots of vector resizing
   unsigned tmp_index;
   std::vector<MultiValue> my_tmp_vals;
+/// Buffers used by sumOverNodes, kept here to avoid allocations at every step
+  std::vector<unsigned> sum_nder;
+  std::vector<unsigned> sum_indices;
+  std::vector<double> sum_values;
 protected:
 /// Is the weight differentiable
   bool weightHasDerivatives();
@@ -119,6 +126,9 @@ public:
   bool storedValueIsActive( const unsigned& iatom ) const ;
 /// Set the active values
   void setActiveValsAndDerivatives( const std::vector<unsigned>& der_index );
+/// Sum the stored data over all the nodes, communicating only the derivatives that are in use.
+/// This requires that each stored value is computed by a single node
+  void sumOverNodes( Communicator& comm, std::vector<double>& buffer, std::vector<unsigned>& der_index );
 /// Activate indexes (this is used at end of chain rule)
   virtual void activateIndices( ActionWithVessel* ) {}
 /// Forces on vectors should always be applied elsewhere